@@ -0,0 +1,59 @@
+/*
+*	Benchmark.h -- Shared settings and timing helpers of the PointcloudBenchmarks program (bench/main.cpp).
+*	Each benchmark prints one line per measurement: what was measured, the fastest of a few runs, and a rate.
+*/
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+
+namespace PointcloudVisualizer
+{
+	namespace Benchmark
+	{
+		struct Settings
+		{
+			/*!
+			*  \brief Largest cloud the benchmarks that scale over cloud sizes may build.
+			*/
+			size_t maxPoints = 100000000;
+
+			/*!
+			*  \brief Runs timed per measurement; the fastest one is reported.
+			*/
+			int repeats = 3;
+		};
+
+		/*!
+		*  \brief Runs 'body' 'repeats' times and returns the fastest run in milliseconds.
+		*/
+		inline double fastestMs(int repeats, const std::function<void()>& body)
+		{
+			double fastest = 0;
+			for (int i = 0; i < repeats; ++i)
+			{
+				auto start = std::chrono::steady_clock::now();
+				body();
+				const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if (i == 0 || ms < fastest)
+					fastest = ms;
+			}
+			return fastest;
+		}
+
+		/*!
+		*  \brief Prints a measurement of 'items' items of 'unit' done in 'ms' milliseconds.
+		*/
+		inline void report(const std::string& name, size_t items, const std::string& unit, double ms)
+		{
+			std::cout << name << ": " << ms << " ms, " << (ms > 0 ? items / ms / 1000.0 : 0.0) << " M " << unit << "/s" << std::endl;
+		}
+
+		void runKdTree(const Settings& settings);
+		void runMeshBuilder(const Settings& settings);
+		void runTokenizer(const Settings& settings);
+	}
+}
@@ -0,0 +1,82 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "KdTree.h"
+#include "MortonOrder.h"
+
+namespace PointcloudVisualizer
+{
+	namespace Benchmark
+	{
+		namespace
+		{
+			// Queries per measurement; larger clouds are queried at a sample of their points.
+			const size_t QUERIES = 1000000;
+
+			// Neighbours per kNN query, and the expected number of points within the radius of a radius query.
+			const size_t NEIGHBOURS = 8;
+			const double RADIUS_POINTS = 16;
+
+			// A scan-like cloud: noisy samples of a few planes, in Morton order as --spatial-sort loads them.
+			std::vector<glm::vec3> ScanCloud(size_t count)
+			{
+				std::mt19937 random(42);
+				std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+				std::normal_distribution<float> noise(0.0f, 0.002f);
+				std::vector<glm::vec3> points(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					const float u = unit(random), v = unit(random), n = noise(random);
+					switch (i % 3)
+					{
+					case 0: points[i] = glm::vec3(u, v, n); break;
+					case 1: points[i] = glm::vec3(u, n, v); break;
+					default: points[i] = glm::vec3(n + 0.5f, u, v); break;
+					}
+				}
+				sortMorton(points);
+				return points;
+			}
+		}
+
+		void runKdTree(const Settings& settings)
+		{
+			for (size_t count : { size_t(1000000), size_t(10000000), size_t(100000000) })
+			{
+				if (count > settings.maxPoints)
+					break;
+
+				const std::vector<glm::vec3> points = ScanCloud(count);
+				const std::string cloud = "kdtree " + std::to_string(count / 1000000) + "M";
+
+				KdTree tree;
+				report(cloud + " build", count, "points", fastestMs(settings.repeats, [&] { tree.build(points.data(), points.size()); }));
+
+				// Every count / queries-th point, so the queries stay in spatial order.
+				const size_t queries = std::min(count, QUERIES);
+				std::vector<glm::vec3> sample(queries);
+				for (size_t i = 0; i < queries; ++i)
+					sample[i] = points[i * (count / queries)];
+
+				std::vector<uint32_t> indices(queries * NEIGHBOURS);
+				std::vector<float> squaredDistances(queries * NEIGHBOURS);
+				report(cloud + " knn k=" + std::to_string(NEIGHBOURS), queries, "queries", fastestMs(settings.repeats, [&]
+				{
+					tree.nearest(sample.data(), sample.size(), NEIGHBOURS, indices.data(), squaredDistances.data());
+				}));
+
+				// The points lie on three unit squares, so a disc of radius r holds about count / 3 * pi * r^2 points.
+				const float radius = static_cast<float>(std::sqrt(RADIUS_POINTS * 3.0 / (3.14159265 * count)));
+				std::vector<size_t> offsets;
+				std::vector<uint32_t> found;
+				report(cloud + " radius", queries, "queries", fastestMs(settings.repeats, [&]
+				{
+					tree.withinRadius(sample.data(), sample.size(), radius, offsets, found);
+				}));
+				std::cout << cloud + " radius: " << static_cast<double>(found.size()) / queries << " neighbours per query" << std::endl;
+			}
+		}
+	}
+}
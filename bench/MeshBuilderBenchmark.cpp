@@ -0,0 +1,111 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <vector>
+#include "MeshBuilder.h"
+#include "PointStatistics.h"
+
+namespace PointcloudVisualizer
+{
+	namespace Benchmark
+	{
+		namespace
+		{
+			// A 4K depth image.
+			const int ROWS = 2160;
+			const int COLUMNS = 3840;
+
+			// A smooth surface with a few steps, in the range of a depth camera in metres.
+			cv::Mat DepthImage()
+			{
+				cv::Mat depth(ROWS, COLUMNS, CV_32F);
+				for (int i = 0; i < ROWS; ++i)
+				{
+					float* row = depth.ptr<float>(i);
+					for (int j = 0; j < COLUMNS; ++j)
+						row[j] = 1.0f + 0.5f * (i % 512) / 512.0f + 0.25f * (j / 960);
+				}
+				return depth;
+			}
+
+			// The CPU part of the old CloudMesh::loadVAO_CV(): two triangles of six vertices per grid cell, pushed
+			// one by one, a normal per triangle, and the bounds tracked in the same loop.
+			size_t LegacyBuild(const cv::Mat& dataCV)
+			{
+				std::vector<glm::vec3> transVecs;
+				std::vector<glm::vec3> normals;
+
+				float x_min, y_min, z_min, x_max, y_max, z_max;
+				x_min = y_min = z_min = 99999999;
+				x_max = y_max = z_max = -99999999;
+
+				for (int i = 0; i < dataCV.rows - 1; ++i) {
+					for (int j = 0; j < dataCV.cols - 1; ++j) {
+
+						if (j < x_min) { x_min = j; }
+						if (j > x_max) { x_max = j; }
+						if (i < y_min) { y_min = i; }
+						if (i > y_max) { y_max = i; }
+
+						float d1 = dataCV.at<float>(i, j);
+						float d2 = dataCV.at<float>(i, j + 1);
+						float d3 = dataCV.at<float>(i + 1, j);
+						float d4 = dataCV.at<float>(i + 1, j + 1);
+						std::vector<float> vec{ d1, d2, d3, d4 };
+						float dmin = *std::min_element(vec.begin(), vec.end());
+						float dmax = *std::max_element(vec.begin(), vec.end());
+
+						if (dmin < z_min) { z_min = dmin; }
+						if (dmax > z_max) { z_max = dmax; }
+
+						transVecs.push_back(glm::vec3(i, j, d1));
+						transVecs.push_back(glm::vec3(i, j + 1, d2));
+						transVecs.push_back(glm::vec3(i + 1, j, d3));
+
+						transVecs.push_back(glm::vec3(i, j + 1, d2));
+						transVecs.push_back(glm::vec3(i + 1, j + 1, d4));
+						transVecs.push_back(glm::vec3(i + 1, j, d3));
+					}
+				}
+
+				for (size_t i = 0; i < transVecs.size(); i += 3) {
+					glm::vec3 normal =
+						glm::normalize(
+							glm::cross(
+								glm::vec3(transVecs[i + 1]) - glm::vec3(transVecs[i]),
+								glm::vec3(transVecs[i + 2]) - glm::vec3(transVecs[i])
+							)
+						);
+					normals.push_back(normal);
+				}
+				return transVecs.size();
+			}
+		}
+
+		void runMeshBuilder(const Settings& settings)
+		{
+			const cv::Mat depth = DepthImage();
+			const size_t samples = static_cast<size_t>(ROWS) * COLUMNS;
+			const std::string image = "meshbuilder " + std::to_string(COLUMNS) + "x" + std::to_string(ROWS);
+
+			size_t legacyVertices = 0;
+			const double legacyMs = fastestMs(settings.repeats, [&] { legacyVertices = LegacyBuild(depth); });
+			report(image + " loadVAO_CV()", samples, "samples", legacyMs);
+
+			// The templated builder writes into presized arrays, as into a mapped GPU buffer, and the bounds come
+			// from the depth statistics, as in CloudMesh::updateStatistics().
+			const GridSource<CvAccess> source{ CvAccess(depth) };
+			std::vector<glm::vec3> vertices(source.units() * GridSource<CvAccess>::VERTICES);
+			std::vector<glm::vec3> normals(source.units() * GridSource<CvAccess>::NORMALS);
+			ColumnStatistics statistics;
+			const double builderMs = fastestMs(settings.repeats, [&]
+			{
+				statistics = computeColumnStatistics(depth.ptr<float>(0), samples);
+				buildMesh(source, 0, source.units(), vertices.data(), normals.data());
+			});
+			report(image + " buildMesh<GridSource<CvAccess>>", samples, "samples", builderMs);
+
+			std::cout << image + ": " << legacyVertices << " vertices before, " << vertices.size() << " now, "
+				<< (builderMs > 0 ? legacyMs / builderMs : 0.0) << "x faster" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+#include <charconv>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <vector>
+#include "AsciiParser.h"
+#include "CpuFeatures.h"
+#include "StringUtils.h"
+
+namespace PointcloudVisualizer
+{
+	namespace Benchmark
+	{
+		namespace
+		{
+			const size_t LINES = 1000000;
+
+			// 'lines' rows of 'fields' random numbers, separated as in csv files (",") or ascii pcd files (" ").
+			std::vector<std::string> Rows(size_t lines, int fields, char separator)
+			{
+				std::mt19937 random(7);
+				std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+				std::vector<std::string> rows(lines);
+				for (std::string& row : rows)
+				{
+					std::ostringstream text;
+					for (int f = 0; f < fields; ++f)
+						text << (f ? std::string(1, separator) : std::string()) << value(random);
+					row = text.str();
+				}
+				return rows;
+			}
+
+			// Row parsing with the fields split by tokenizeView() first, the alternative to the separator skipping
+			// in AsciiChunkParser::parseLine(). Returns the sum of the values, to compare the two.
+			double SplitAndParse(const std::vector<std::string>& rows, char separator, std::vector<std::string_view>& tokens)
+			{
+				const char delimiters[4] = { separator, ' ', '\t', '\r' };
+				double sum = 0;
+				for (const std::string& row : rows)
+				{
+					tokenizeView(row, std::string_view(delimiters, 4), tokens);
+					for (const std::string_view& token : tokens)
+					{
+						const char* begin = token.data() + (token[0] == '+' ? 1 : 0);
+						double value = 0;
+						std::from_chars(begin, token.data() + token.size(), value);
+						sum += value;
+					}
+				}
+				return sum;
+			}
+		}
+
+		void runTokenizer(const Settings& settings)
+		{
+			const SimdLevel selected = simdLevel();
+			struct Workload { const char* name; int fields; char separator; };
+			for (const Workload& workload : { Workload{ "csv xyz", 3, ',' }, Workload{ "pcd 16 fields", 16, ' ' } })
+			{
+				const std::vector<std::string> rows = Rows(LINES, workload.fields, workload.separator);
+				const std::string name = std::string("tokenizer ") + workload.name;
+
+				// The old tokenizer copies the line and every token into new strings.
+				size_t count = 0;
+				report(name + " tokenize()", rows.size(), "lines", fastestMs(settings.repeats, [&]
+				{
+					count = 0;
+					for (const std::string& row : rows)
+						count += tokenize(row, " ,").size();
+				}));
+
+				std::vector<std::string_view> tokens;
+				for (int level = static_cast<int>(SimdLevel::Scalar); level <= static_cast<int>(selected); ++level)
+				{
+					setSimdLevel(static_cast<SimdLevel>(level));
+					size_t viewCount = 0;
+					report(name + " tokenizeView() " + simdLevelName(simdLevel()), rows.size(), "lines", fastestMs(settings.repeats, [&]
+					{
+						viewCount = 0;
+						for (const std::string& row : rows)
+							viewCount += tokenizeView(row, " ,", tokens);
+					}));
+					if (viewCount != count)
+						std::cerr << "WARNING: tokenizeView() found " << viewCount << " tokens, tokenize() " << count << "." << std::endl;
+				}
+				setSimdLevel(selected);
+
+				// Splitting whole rows up front against the parser's own skipping, including the number conversion.
+				std::vector<double> values(workload.fields);
+				double sum = 0, splitSum = 0;
+				report(name + " parseLine()", rows.size(), "lines", fastestMs(settings.repeats, [&]
+				{
+					sum = 0;
+					for (const std::string& row : rows)
+					{
+						AsciiChunkParser::parseLine(row.data(), row.data() + row.size(), workload.separator, values.data(), values.size());
+						for (double value : values)
+							sum += value;
+					}
+				}));
+				report(name + " tokenizeView() + from_chars", rows.size(), "lines", fastestMs(settings.repeats, [&]
+				{
+					splitSum = SplitAndParse(rows, workload.separator, tokens);
+				}));
+				if (splitSum != sum)
+					std::cerr << "WARNING: tokenizeView() parsing summed to " << splitSum << ", parseLine() " << sum << "." << std::endl;
+			}
+		}
+	}
+}
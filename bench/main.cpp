@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "Benchmark.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+int main(int argc, char** argv)
+{
+	// Parse options; the remaining arguments name the benchmarks to run.
+	PointcloudVisualizer::Benchmark::Settings settings;
+	unsigned int threads = 0;
+	std::string selected = "all";
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument.rfind("--max-points=", 0) == 0)
+			settings.maxPoints = std::strtoull(argument.c_str() + 13, nullptr, 10);
+		else if (argument.rfind("--repeats=", 0) == 0)
+			settings.repeats = std::max(1, std::atoi(argument.c_str() + 10));
+		else if (argument.rfind("--threads=", 0) == 0)
+			threads = static_cast<unsigned int>(std::strtoul(argument.c_str() + 10, nullptr, 10));
+		else if (argument.rfind("--simd=", 0) == 0)
+		{
+			PointcloudVisualizer::SimdLevel level;
+			if (!PointcloudVisualizer::parseSimdLevel(argument.substr(7), level))
+			{
+				std::cerr << "ERROR! Unknown SIMD level '" << argument.substr(7) << "', expected scalar, sse2, avx2 or avx512." << std::endl;
+				return -1;
+			}
+			PointcloudVisualizer::setSimdLevel(level);
+		}
+		else if (argument == "kdtree" || argument == "meshbuilder" || argument == "tokenizer")
+			selected = argument;
+		else
+		{
+			std::cerr << "ERROR! Arguments must be of the format: 'PointcloudBenchmarks [options] [kdtree|meshbuilder|tokenizer]'." << std::endl;
+			std::cerr << "Options: --max-points=<N> (largest cloud built, default 100000000)" << std::endl;
+			std::cerr << "         --repeats=<N> (runs per measurement, the fastest is reported, default 3)" << std::endl;
+			std::cerr << "         --threads=<N> (threads of the job system, default: all hardware threads)" << std::endl;
+			std::cerr << "         --simd=scalar|sse2|avx2|avx512 (highest instruction set the kernels may use)" << std::endl;
+			return -1;
+		}
+	}
+
+	PointcloudVisualizer::JobSystem jobs(threads);
+	jobs.makeCurrent();
+	std::cout << jobs.threadCount() << " threads, " << PointcloudVisualizer::simdLevelName(PointcloudVisualizer::simdLevel()) << std::endl;
+
+	if (selected == "all" || selected == "kdtree")
+		PointcloudVisualizer::Benchmark::runKdTree(settings);
+	if (selected == "all" || selected == "meshbuilder")
+		PointcloudVisualizer::Benchmark::runMeshBuilder(settings);
+	if (selected == "all" || selected == "tokenizer")
+		PointcloudVisualizer::Benchmark::runTokenizer(settings);
+	return 0;
+}
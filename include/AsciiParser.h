@@ -0,0 +1,59 @@
+/*
+*	AsciiParser.h -- Multi-threaded parser for delimited ASCII rows of numbers (PCD 'DATA ascii' bodies, CSV).
+*/
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Called once per data row with the row's index in file order and exactly 'columns' parsed values.
+	*  Rows of different chunks are written concurrently, so a writer must only touch state owned by its row.
+	*/
+	typedef std::function<void(size_t row, const double* values)> AsciiRowWriter;
+
+	class AsciiChunkParser
+	{
+	public:
+
+		/*!
+		*  \brief Splits [begin, end) into one chunk per worker at newline boundaries and counts the data rows
+		*  of every chunk in parallel. Values are separated by runs of the delimiter, spaces, tabs or '\r'.
+		*  Blank lines and lines starting with '#' are not data rows.
+		*/
+		AsciiChunkParser(const char* begin, const char* end, char delimiter, size_t columns);
+
+		/*!
+		*  \brief Total number of data rows, known before anything is parsed so outputs can be sized exactly.
+		*/
+		size_t rows() const { return totalRows; }
+
+		/*!
+		*  \brief Parses every chunk on its own thread. Row indices are offset by the row counts of earlier
+		*  chunks, so the output is in file order without a merge pass. Rows at or past maxRows are skipped.
+		*  Missing trailing values are 0, extra values are ignored.
+		*/
+		void parse(const AsciiRowWriter& writer, size_t maxRows = static_cast<size_t>(-1)) const;
+
+		/*!
+		*  \brief Parses one line into at most 'columns' values without allocating. Returns the number of
+		*  values found; unparsable tokens read as 0.
+		*/
+		static size_t parseLine(const char* begin, const char* end, char delimiter, double* values, size_t columns);
+
+		/*!
+		*  \brief True if the line holds data: it is not blank and does not start with '#'.
+		*/
+		static bool isDataRow(const char* begin, const char* end, char delimiter);
+
+	private:
+		char delimiter;
+		size_t columns;
+		std::vector<const char*> chunkBegins;
+		std::vector<size_t> chunkFirstRow;
+		size_t totalRows = 0;
+	};
+}
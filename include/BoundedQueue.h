@@ -0,0 +1,106 @@
+/*
+*	BoundedQueue.h -- Fixed-capacity lock-free queue for handing work between pipeline stages.
+*	Any number of threads may push and pop. A full queue rejects pushes instead of growing, which is what
+*	bounds the memory a staged pipeline holds in flight.
+*/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace PointcloudVisualizer
+{
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+
+		/*!
+		*  \brief Creates a queue holding at least 'capacity' items (rounded up to a power of two).
+		*/
+		explicit BoundedQueue(size_t capacity)
+		{
+			size_t size = 2;
+			while (size < capacity)
+				size *= 2;
+			mask = size - 1;
+			cells.reset(new Cell[size]);
+			for (size_t i = 0; i < size; ++i)
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		size_t capacity() const { return mask + 1; }
+
+		/*!
+		*  \brief Moves 'value' into the queue. Returns false and leaves 'value' untouched if the queue is full.
+		*/
+		bool tryPush(T&& value)
+		{
+			size_t position = tail.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell& cell = cells[position & mask];
+				size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				if (sequence == position)
+				{
+					if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.value = std::move(value);
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (sequence < position)
+					return false;
+				else
+					position = tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		/*!
+		*  \brief Moves the oldest item into 'value'. Returns false if the queue is empty.
+		*/
+		bool tryPop(T& value)
+		{
+			size_t position = head.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell& cell = cells[position & mask];
+				size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				if (sequence == position + 1)
+				{
+					if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						value = std::move(cell.value);
+						cell.value = T();
+						cell.sequence.store(position + mask + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (sequence < position + 1)
+					return false;
+				else
+					position = head.load(std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		// A cell is free for the push at position p while sequence == p, and holds that item while sequence == p + 1.
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+		size_t mask = 0;
+
+		// Producers and consumers contend on different cache lines.
+		alignas(64) std::atomic<size_t> tail{ 0 };
+		alignas(64) std::atomic<size_t> head{ 0 };
+	};
+}
@@ -0,0 +1,115 @@
+/*
+*	CloudCache.h -- Binary sidecar cache (<source>.pcvcache) written after a cloud is parsed once and
+*	memory-mapped on later runs instead of parsing the source again.
+*/
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MappedFile.h"
+#include "PointStatistics.h"
+
+namespace PointcloudVisualizer
+{
+	class CloudCache
+	{
+	public:
+
+		/*!
+		*  \brief Fixed-size file header. It is followed by fieldCount FieldEntry records, then by the
+		*  positions and every column, each starting on a 64-byte boundary. Caches are written with positions
+		*  only; the field records keep caches with columns from earlier versions readable.
+		*/
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t fieldCount;
+			uint64_t pointCount;
+			uint64_t sourceSize;
+			int64_t sourceTime;
+			uint64_t sourceChecksum;
+			float boundsMin[3];
+			float boundsMax[3];
+			uint64_t positionsOffset;
+		};
+
+		struct FieldEntry
+		{
+			char name[32];
+			uint32_t size;
+			uint32_t count;
+			uint64_t offset;
+			char type;
+			char padding[7];
+		};
+
+		/*!
+		*  \brief Path of the sidecar cache for a source file.
+		*/
+		static std::string cachePath(const std::string& sourceFilename);
+
+		/*!
+		*  \brief Identifies a source file version without reading all of it: size, modification time and an
+		*  FNV-1a hash of its first and last MiB. Also used by other sidecar files built from a source.
+		*/
+		static bool sourceSignature(const std::string& sourceFilename, uint64_t& size, int64_t& time, uint64_t& checksum);
+
+		/*!
+		*  \brief Writes the cache for a source file: positions and their bounds.
+		*  Written to a temporary file and renamed, so a crash never leaves a valid-looking partial cache.
+		*/
+		static bool write(const std::string& sourceFilename, const std::vector<glm::vec3>& positions);
+
+		/*!
+		*  \brief Writes a cache batch by batch, for sources that are streamed instead of held in memory
+		*  at once. The header is rewritten with the final count and bounds by finish(); a writer destroyed or
+		*  abandoned before that removes its temporary file.
+		*/
+		class Writer
+		{
+		public:
+			~Writer() { abandon(); }
+
+			bool begin(const std::string& sourceFilename);
+			bool append(const glm::vec3* positions, size_t count);
+			bool finish();
+			void abandon();
+
+			size_t size() const { return static_cast<size_t>(header.pointCount); }
+
+		private:
+			std::ofstream out;
+			std::string path;
+			Header header = {};
+			PointStatistics statistics;
+		};
+
+		/*!
+		*  \brief Maps the cache of a source file if one exists and still matches the source's size,
+		*  modification time and checksum. Returns false if the source has to be parsed.
+		*/
+		bool open(const std::string& sourceFilename);
+
+		void close();
+
+		bool isOpen() const { return file != nullptr; }
+		size_t size() const { return header ? static_cast<size_t>(header->pointCount) : 0; }
+
+		/*!
+		*  \brief Positions inside the mapping, valid until close().
+		*/
+		const glm::vec3* positions() const;
+
+		glm::vec3 boundsMin() const { return glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]); }
+		glm::vec3 boundsMax() const { return glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]); }
+
+	private:
+		std::unique_ptr<MappedFile> file;
+		const Header* header = nullptr;
+	};
+}
@@ -0,0 +1,128 @@
+/*
+*	CloudLoader.h -- Loads a pointcloud file on a background thread and hands the points over in batches,
+*	so rendering can start before the whole file is parsed.
+*	CSV files run through a staged pipeline: the loader thread reads fixed-size chunks of the mapped file,
+*	jobs on the JobSystem parse them and drop non-finite points, the loader thread puts the results back in
+*	file order, and the render thread uploads them. Bounded queues connect the stages, so reading,
+*	parsing and uploading overlap and the data in flight is limited by the queue depth, not the file size.
+*/
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <opencv2/opencv.hpp>
+#include "BoundedQueue.h"
+#include "CloudCache.h"
+#include "PointFilters.h"
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief How pcd and csv files are loaded.
+	*/
+	struct LoadOptions
+	{
+		/*!
+		*  \brief Use and refresh the .pcvcache sidecar.
+		*/
+		bool useCache = true;
+
+		/*!
+		*  \brief Hand the points over in Morton order (see MortonOrder.h) and cache them that way.
+		*/
+		bool spatialSort = false;
+
+		/*!
+		*  \brief Downsample to one point per voxel of this size before the hand-over (see voxelDownsample);
+		*  0 keeps every point. The cache keeps every point.
+		*/
+		float voxelSize = 0.0f;
+		VoxelMode voxelMode = VoxelMode::Centroid;
+
+		/*!
+		*  \brief Drop points whose mean distance to their outlierNeighbours nearest neighbours is more than this many
+		*  standard deviations above average, after downsampling (see removeOutliers); 0 keeps every point.
+		*/
+		float outlierSigma = 0.0f;
+		unsigned int outlierNeighbours = 8;
+	};
+
+	class CloudLoader
+	{
+	public:
+
+		/*!
+		*  \brief One handoff unit: either a batch of positions appended to the loading cloud, or a whole
+		*  depth image that becomes its own mesh.
+		*/
+		struct Batch
+		{
+			std::vector<glm::vec3> points;
+			cv::Mat image;
+		};
+
+		CloudLoader();
+		~CloudLoader();
+
+		CloudLoader(const CloudLoader&) = delete;
+		CloudLoader& operator=(const CloudLoader&) = delete;
+
+		/*!
+		*  \brief Starts loading on the worker thread. csv files are streamed unless 'options' sort or filter the
+		*  points, which needs them all before the first batch. A load that is still running is cancelled first.
+		*/
+		void start(const std::string& filename, const LoadOptions& options = LoadOptions());
+
+		/*!
+		*  \brief Asks the worker to stop at its next batch boundary and waits for it.
+		*/
+		void cancel();
+
+		bool isLoading() const { return running.load(); }
+		float progress() const { return progressValue.load(); }
+
+		/*!
+		*  \brief Moves every batch produced since the last call into 'batches'. Safe to call while loading.
+		*  The loader stalls once the handoff queue is full, so call this regularly.
+		*/
+		size_t takeBatches(std::vector<Batch>& batches);
+
+	private:
+		std::thread worker;
+		BoundedQueue<Batch> ready;
+		std::atomic<bool> running{ false };
+		std::atomic<bool> cancelled{ false };
+		std::atomic<float> progressValue{ 0.0f };
+		LoadOptions options;
+
+		void Run(std::string filename);
+
+		/*!
+		*  \brief Runs the read, parse and reorder stages over a CSV file, appending the points to 'allPoints' and
+		*  'cache' if given and handing them over unless 'handOff' is false. Returns false if the file could not be
+		*  read or loading was cancelled.
+		*/
+		bool StreamCsv(const std::string& filename, std::vector<glm::vec3>* allPoints, CloudCache::Writer* cache, bool handOff = true);
+
+		/*!
+		*  \brief Hands positions over in slices so the render thread can show them while later ones load.
+		*  Non-finite points are dropped. Returns false if loading was cancelled.
+		*/
+		bool PushPoints(const glm::vec3* points, size_t count, float progressBegin, float progressEnd);
+
+		/*!
+		*  \brief Runs the filters of 'options' over the points and hands the result over. Returns false if there
+		*  are none, leaving the points to the caller.
+		*/
+		bool FilterPoints(const glm::vec3* points, size_t count, float progressBegin, float progressEnd);
+
+		/*!
+		*  \brief Waits for room in the handoff queue and moves the batch into it. Returns false if loading
+		*  was cancelled first.
+		*/
+		bool Push(Batch&& batch);
+	};
+}
@@ -0,0 +1,79 @@
+/*
+*	CpuFeatures.h -- Runtime CPU feature detection and SIMD tier selection for the hot kernels.
+*	Kernels are compiled for every tier with per-function target attributes, and each call picks the widest
+*	implementation the active tier allows, so one binary runs on any x86 machine.
+*/
+
+#pragma once
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPUFEATURES_X86 1
+#include <immintrin.h>
+#endif
+
+// MSVC accepts any intrinsic in any function; GCC and Clang need the instruction set enabled per function.
+#if defined(__GNUC__) && !defined(_MSC_VER)
+#define CPUFEATURES_TARGET_AVX2 __attribute__((target("avx2,bmi")))
+#define CPUFEATURES_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CPUFEATURES_TARGET_AVX2
+#define CPUFEATURES_TARGET_AVX512
+#endif
+
+namespace PointcloudVisualizer
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		Sse2,
+		Avx2,
+		Avx512
+	};
+
+	/*!
+	*  \brief Widest tier the CPU and the OS support, detected once on first use.
+	*/
+	SimdLevel detectedSimdLevel();
+
+	/*!
+	*  \brief Tier the kernels dispatch to: the detected one, unless lowered with setSimdLevel().
+	*/
+	SimdLevel simdLevel();
+
+	/*!
+	*  \brief Forces a tier, e.g. to compare kernels in benchmarks. Tiers above the detected one are clamped
+	*  with a warning.
+	*/
+	void setSimdLevel(SimdLevel level);
+
+	/*!
+	*  \brief Parses "scalar", "sse2", "avx2" or "avx512". Returns false for anything else.
+	*/
+	bool parseSimdLevel(const std::string& name, SimdLevel& level);
+
+	const char* simdLevelName(SimdLevel level);
+
+	/*!
+	*  \brief Returns the implementation of the widest tier up to simdLevel() that has one. Tiers without an
+	*  implementation are passed as nullptr and skipped; the result is nullptr if no allowed tier has one.
+	*/
+	template<typename Function>
+	Function selectKernel(Function scalar, Function sse2, Function avx2, Function avx512)
+	{
+		switch (simdLevel())
+		{
+		case SimdLevel::Avx512:
+			if (avx512) return avx512;
+			// fall through
+		case SimdLevel::Avx2:
+			if (avx2) return avx2;
+			// fall through
+		case SimdLevel::Sse2:
+			if (sse2) return sse2;
+			// fall through
+		default:
+			return scalar;
+		}
+	}
+}
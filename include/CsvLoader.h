@@ -0,0 +1,125 @@
+/*
+*	CsvLoader.h -- Loader for delimited ASCII point files with configurable delimiter, header skipping and
+*	column mapping. Loads whole files in parallel or streams them in fixed-size batches.
+*/
+
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "PointColumns.h"
+
+namespace PointcloudVisualizer
+{
+	class CsvLoader
+	{
+	public:
+
+		/*!
+		*  \brief Maps an output field to a CSV column. With index < 0 the column is looked up by name in
+		*  the file's header row.
+		*/
+		struct Column
+		{
+			std::string name;
+			int index = -1;
+		};
+
+		struct Options
+		{
+			char delimiter = ',';
+
+			/*!
+			*  \brief Lines dropped unconditionally before looking for a header or data.
+			*/
+			size_t skipRows = 0;
+
+			/*!
+			*  \brief Treat the first remaining line as a header row if it does not start with a number.
+			*/
+			bool detectHeader = true;
+
+			/*!
+			*  \brief Output fields. The first three are the x, y and z positions; any further ones are only
+			*  written by the PointColumns overload of load().
+			*/
+			std::vector<Column> columns{ { "x", 0 }, { "y", 1 }, { "z", 2 } };
+		};
+
+		CsvLoader(const std::string& filename);
+		CsvLoader(const std::string& filename, const Options& options);
+
+		/*!
+		*  \brief Parses the whole file in parallel into a contiguous position buffer.
+		*/
+		bool load(std::vector<glm::vec3>& positions);
+
+		/*!
+		*  \brief Parses the whole file in parallel into one float column per mapped field.
+		*/
+		bool load(PointColumns& columns);
+
+		/*!
+		*  \brief Streaming mode: replaces the contents of 'batch' with the next batchSize points at most,
+		*  reading the file through a fixed-size window so memory stays bounded. Returns false at the end.
+		*/
+		bool nextBatch(std::vector<glm::vec3>& batch, size_t batchSize);
+
+		/*!
+		*  \brief Pipelined mode: parses the data rows of [begin, end), a range of the mapped file that starts
+		*  at or after dataBegin() and on a line boundary, appending their positions to 'points'. Does not
+		*  touch the streaming state, so several ranges can be parsed concurrently.
+		*/
+		void parseRows(const char* begin, const char* end, std::vector<glm::vec3>& points) const;
+
+		/*!
+		*  \brief True if the file was opened and its columns were mapped, i.e. there are rows to load.
+		*/
+		bool isOpen() const { return !columnIndices.empty(); }
+
+		/*!
+		*  \brief Byte offset of the first data row, past skipped rows and the header.
+		*/
+		size_t dataBegin() const { return dataOffset; }
+
+		/*!
+		*  \brief Fraction of the file consumed by streaming so far, in [0, 1].
+		*/
+		float progress() const;
+
+		/*!
+		*  \brief Rewinds streaming to the first data row.
+		*/
+		void rewind();
+
+		/*!
+		*  \brief Header names found in the file, empty if it has no header row.
+		*/
+		const std::vector<std::string>& headerNames() const { return names; }
+
+	private:
+		std::string filename;
+		Options options;
+		std::vector<std::string> names;
+		std::vector<int> columnIndices;
+		size_t valuesPerRow = 0;
+		size_t fileSize = 0;
+		size_t dataOffset = 0;
+
+		// Streaming state.
+		std::ifstream stream;
+		std::vector<char> window;
+		size_t windowBegin = 0;
+		size_t windowEnd = 0;
+		size_t consumed = 0;
+		std::vector<double> rowValues;
+
+		/*!
+		*  \brief Finds the first data row and resolves the column mapping from the header row.
+		*/
+		bool ScanHeader(const char* begin, const char* end);
+
+		bool RefillWindow();
+	};
+}
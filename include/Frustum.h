@@ -0,0 +1,62 @@
+/*
+*	Frustum.h -- View frustum planes and culling of axis-aligned boxes against them.
+*	Boxes are kept one array per coordinate, so the plane tests run on 4, 8 or 16 boxes at a time with SSE2,
+*	AVX2 or AVX-512 (see CpuFeatures.h).
+*/
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Axis-aligned boxes, one array per coordinate of their minimum and maximum corners.
+	*/
+	struct BoxList
+	{
+		std::vector<float> minX, minY, minZ;
+		std::vector<float> maxX, maxY, maxZ;
+
+		size_t size() const { return minX.size(); }
+		void resize(size_t count);
+		void set(size_t index, const glm::vec3& min, const glm::vec3& max);
+	};
+
+	class Frustum
+	{
+	public:
+
+		/*!
+		*  \brief A frustum every box intersects, for drawing without culling.
+		*/
+		Frustum();
+
+		/*!
+		*  \brief The frustum of 'clip', e.g. projection * view * model. Its planes are in the space 'clip' maps
+		*  from, so boxes in model space are tested without transforming them.
+		*/
+		explicit Frustum(const glm::mat4& clip);
+
+		/*!
+		*  \brief Planes as (normal, distance), pointing inwards: a point p is inside if dot(normal, p) + distance >= 0
+		*  for all six.
+		*/
+		const glm::vec4& plane(int index) const { return planes[index]; }
+
+		/*!
+		*  \brief True unless the box lies entirely outside one of the planes. Boxes near a corner of the frustum may
+		*  pass without intersecting it, which only costs drawing them.
+		*/
+		bool intersects(const glm::vec3& min, const glm::vec3& max) const;
+
+		/*!
+		*  \brief Writes 1 to visible[i - begin] for every box i in [begin, end) that intersects the frustum, 0 otherwise.
+		*/
+		void cull(const BoxList& boxes, size_t begin, size_t end, unsigned char* visible) const;
+
+	private:
+		glm::vec4 planes[6];
+	};
+}
@@ -0,0 +1,103 @@
+/*
+*	JobSystem.h -- Work-stealing thread pool shared by the loaders, mesh builders and filters.
+*	Every worker owns a deque: it pushes and pops its own jobs at the back while idle workers steal from the
+*	front. Jobs can depend on other jobs, and threads waiting for a job run queued jobs in the meantime, so
+*	nested parallel loops neither deadlock nor oversubscribe the cores.
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PointcloudVisualizer
+{
+	class JobSystem
+	{
+	public:
+		class Job;
+		typedef std::shared_ptr<Job> Handle;
+
+		/*!
+		*  \brief Starts the pool for 'threads' threads including the caller (0 uses hardware_concurrency).
+		*  At least one worker thread is started, so submitted jobs run even with a single thread.
+		*/
+		explicit JobSystem(unsigned int threads = 0);
+
+		/*!
+		*  \brief Runs every queued job, then joins the workers.
+		*/
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/*!
+		*  \brief Number of threads work is split across, including the thread that waits for it.
+		*/
+		unsigned int threadCount() const { return threads; }
+
+		/*!
+		*  \brief Queues 'work' to run once every job in 'dependencies' has finished. If 'work' throws, the job still
+		*  finishes and wait() rethrows the exception; dependents of a failed job skip their work and fail with it.
+		*/
+		Handle submit(std::function<void()> work, const std::vector<Handle>& dependencies = std::vector<Handle>());
+
+		static bool isDone(const Handle& job);
+
+		/*!
+		*  \brief Returns once 'job' has finished, running other queued jobs while it waits. Rethrows what the job
+		*  or one of its dependencies threw.
+		*/
+		void wait(const Handle& job);
+
+		/*!
+		*  \brief Splits [begin, end) into contiguous ranges of at least 'grain' items, a few per thread so idle
+		*  threads can steal from slow ones, and calls body(rangeBegin, rangeEnd) for each. The caller runs one
+		*  range itself and returns once every range is done, then rethrows the first exception a range threw.
+		*/
+		void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+		/*!
+		*  \brief Makes this pool the one parallelFor() in Parallel.h submits to, until it is destroyed.
+		*/
+		void makeCurrent();
+
+		/*!
+		*  \brief The pool made current, or a process-wide default pool if there is none.
+		*/
+		static JobSystem& current();
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Handle> jobs;
+		};
+
+		unsigned int threads;
+		std::vector<std::thread> workers;
+
+		// One deque per worker, followed by the queue for jobs submitted from other threads.
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::atomic<size_t> queued{ 0 };
+		bool stopping = false;
+
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+		std::condition_variable finished;
+		int waiting = 0;
+
+		void Enqueue(const Handle& job);
+		bool RunOne(int self);
+		void Execute(const Handle& job);
+		void WorkerLoop(int index);
+		void NotifyWaiters();
+	};
+}
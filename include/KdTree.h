@@ -0,0 +1,87 @@
+/*
+*	KdTree.h -- Implicit KD-tree for nearest-neighbour and radius queries over a point cloud.
+*	The tree is not stored as nodes: the points are reordered so that the median of every range [begin, end) sits
+*	at its middle, with the points below it on the split axis to its left and the others to its right, and only the
+*	split axis is kept per median. Ranges of up to LEAF_POINTS points are scanned linearly. Point and original index
+*	share 16 bytes, so a query walks one contiguous array.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace PointcloudVisualizer
+{
+	class KdTree
+	{
+	public:
+		/*!
+		*  \brief Largest range scanned linearly instead of split further.
+		*/
+		static const size_t LEAF_POINTS = 8;
+
+		/*!
+		*  \brief Index written for neighbours that do not exist, when a query finds fewer than k points.
+		*/
+		static const uint32_t NO_POINT = 0xffffffffu;
+
+		KdTree() {}
+
+		/*!
+		*  \brief Builds the tree over 'count' points, e.g. CloudMesh::points(), splitting large ranges on the
+		*  JobSystem. Queries return indices into 'points'; points with non-finite coordinates are left out.
+		*  Returns false if there are 2^32 points or more.
+		*/
+		bool build(const glm::vec3* points, size_t count);
+
+		void clear();
+		size_t size() const { return entries.size(); }
+		bool empty() const { return entries.empty(); }
+
+		/*!
+		*  \brief Finds the (up to) k points nearest to 'query' and no further than 'maxDistance', and writes their
+		*  indices and squared distances nearest first. Returns how many were found.
+		*/
+		size_t nearest(const glm::vec3& query, size_t k, uint32_t* indices, float* squaredDistances,
+			float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+		/*!
+		*  \brief Batched nearest(): row i of k entries in 'indices' and 'squaredDistances' holds the neighbours of
+		*  queries[i], padded with NO_POINT and infinity. Queries run in parallel, and faster when they are in
+		*  spatial order (see MortonOrder.h).
+		*/
+		void nearest(const glm::vec3* queries, size_t count, size_t k, uint32_t* indices, float* squaredDistances) const;
+
+		/*!
+		*  \brief Appends the indices of the points within 'radius' of 'query', in no particular order.
+		*/
+		void withinRadius(const glm::vec3& query, float radius, std::vector<uint32_t>& indices) const;
+
+		/*!
+		*  \brief Batched withinRadius(): the neighbours of queries[i] are indices[offsets[i]] to
+		*  indices[offsets[i + 1]], so 'offsets' gets count + 1 entries.
+		*/
+		void withinRadius(const glm::vec3* queries, size_t count, float radius, std::vector<size_t>& offsets,
+			std::vector<uint32_t>& indices) const;
+
+	private:
+		struct Entry
+		{
+			glm::vec3 point;
+			uint32_t index;
+		};
+
+		// Points in tree order, and the split axis of the range each one is the median of.
+		std::vector<Entry> entries;
+		std::vector<unsigned char> axes;
+
+		struct Neighbours;
+
+		void Build(size_t begin, size_t end, glm::vec3 min, glm::vec3 max);
+		void SearchNearest(size_t begin, size_t end, const glm::vec3& query, Neighbours& found) const;
+		void SearchRadius(size_t begin, size_t end, const glm::vec3& query, float squaredRadius, std::vector<uint32_t>& found) const;
+	};
+}
@@ -0,0 +1,15 @@
+/*
+*	LZF.h -- Decoder for the LZF stream format used by PCD 'DATA binary_compressed' bodies.
+*/
+
+#pragma once
+#include <cstddef>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Decompresses an LZF stream into a caller-owned buffer. Returns the number of bytes written,
+	*  or 0 if the stream is corrupt or does not fit into outputSize bytes.
+	*/
+	size_t lzfDecompress(const void* input, size_t inputSize, void* output, size_t outputSize);
+}
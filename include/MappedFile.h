@@ -0,0 +1,49 @@
+/*
+*	MappedFile.h -- Read-only memory mapping of a file on disk (Win32 and POSIX).
+*/
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace PointcloudVisualizer
+{
+	class MappedFile
+	{
+	public:
+
+		/*!
+		*  \brief Maps the whole file read-only. Check isOpen() for success.
+		*/
+		MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool isOpen() const { return mapping != nullptr; }
+		const char* data() const { return static_cast<const char*>(mapping); }
+		size_t size() const { return length; }
+
+		/*!
+		*  \brief Hints the OS that the range will be read sequentially and touches every page of it,
+		*  so page faults (disk I/O on a cold cache) are taken here instead of during decoding.
+		*/
+		void prefetch(size_t offset = 0, size_t count = static_cast<size_t>(-1)) const;
+
+		/*!
+		*  \brief Unmaps the file early. Called automatically on destruction.
+		*/
+		void close();
+
+	private:
+		void* mapping = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+}
@@ -0,0 +1,71 @@
+/*
+*	MemoryBudget.h -- Residency policies for the host copy of uploaded clouds, and the budget that evicts
+*	least-recently-drawn meshes from host or GPU memory once the configured limits are exceeded.
+*/
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief What happens to the host copy of a mesh once all of it is on the GPU: Keep it, Release it (the mesh
+	*  can no longer be uploaded again), or Spill it to a temporary binary file it is read back from when needed.
+	*/
+	enum class Residency
+	{
+		Keep,
+		Release,
+		Spill
+	};
+
+	/*!
+	*  \brief Parses "keep", "release" or "spill". Returns false for anything else.
+	*/
+	bool parseResidency(const std::string& name, Residency& residency);
+
+	const char* residencyName(Residency residency);
+
+	class MemoryBudget
+	{
+	public:
+
+		/*!
+		*  \brief Memory one mesh holds, and what may be evicted. Host data is evicted by spilling it, GPU data by
+		*  deleting the buffers of a mesh that can still be uploaded again.
+		*/
+		struct Entry
+		{
+			size_t hostBytes = 0;
+			size_t gpuBytes = 0;
+			size_t lastDrawn = 0;
+			bool hostEvictable = false;
+			bool gpuEvictable = false;
+		};
+
+		/*!
+		*  \brief Limits in bytes, 0 for unlimited.
+		*/
+		size_t hostLimit = 0;
+		size_t gpuLimit = 0;
+
+		/*!
+		*  \brief Sums the usage of 'entries' and picks the ones to evict, least recently drawn first, until both
+		*  totals fit their limits. Entries drawn in 'frame' are never picked. Returns false if the limits cannot
+		*  be met by evicting.
+		*/
+		bool plan(const std::vector<Entry>& entries, size_t frame, std::vector<size_t>& hostEvictions, std::vector<size_t>& gpuEvictions);
+
+		/*!
+		*  \brief Totals after the evictions picked by the last plan().
+		*/
+		size_t hostBytes() const { return hostTotal; }
+		size_t gpuBytes() const { return gpuTotal; }
+
+	private:
+		size_t hostTotal = 0;
+		size_t gpuTotal = 0;
+	};
+}
@@ -0,0 +1,160 @@
+/*
+*	MeshBuilder.h -- Builds GPU vertex and normal arrays for a range of a cloud, templated on how the source is read.
+*	One builder serves cv::Mat and row-major std::vector depth images as well as std::vector<glm::vec3> point lists;
+*	the source policy is inlined at compile time and the output is presized, so the inner loop never allocates.
+*	Large ranges are built in parallel, each worker writing a disjoint slice of the output.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include <opencv2/opencv.hpp>
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Fewest units a worker builds, so small ranges stay on the calling thread.
+	*/
+	const size_t MESH_BUILD_GRAIN = 1u << 14;
+
+	/*!
+	*  \brief Reads samples of a single-channel CV_32F depth image.
+	*/
+	struct CvAccess
+	{
+		const cv::Mat& mat;
+
+		explicit CvAccess(const cv::Mat& mat_) : mat(mat_) {}
+
+		size_t rows() const { return mat.empty() ? 0 : mat.rows; }
+		size_t columns() const { return mat.empty() ? 0 : mat.cols; }
+		float operator()(int i, int j) const { return mat.ptr<float>(i)[j]; }
+	};
+
+	/*!
+	*  \brief Reads samples of a row-major std::vector<std::vector<float>> depth image.
+	*/
+	struct RowMajorAccess
+	{
+		const std::vector<std::vector<float>>& data;
+
+		explicit RowMajorAccess(const std::vector<std::vector<float>>& data_) : data(data_) {}
+
+		size_t rows() const { return data.size(); }
+		size_t columns() const { return data.empty() ? 0 : data[0].size(); }
+		float operator()(int i, int j) const { return data[i][j]; }
+	};
+
+	/*!
+	*  \brief Source policy for depth images: every sample is one unit, emitted once as (row, column, depth) with
+	*  a normal from central differences, oriented like the normals of the two triangles of each grid cell.
+	*/
+	template<typename Access>
+	struct GridSource
+	{
+		static const size_t VERTICES = 1;
+		static const size_t NORMALS = 1;
+
+		Access access;
+
+		explicit GridSource(const Access& access_) : access(access_) {}
+
+		size_t units() const { return access.rows() * access.columns(); }
+
+		void emit(size_t unit, glm::vec3* vertex, glm::vec3* normal) const
+		{
+			const int rows = static_cast<int>(access.rows()), columns = static_cast<int>(access.columns());
+			const int i = static_cast<int>(unit / columns), j = static_cast<int>(unit % columns);
+			const int up = std::max(i - 1, 0), down = std::min(i + 1, rows - 1);
+			const int left = std::max(j - 1, 0), right = std::min(j + 1, columns - 1);
+
+			vertex[0] = glm::vec3(i, j, access(i, j));
+			normal[0] = glm::normalize(glm::vec3(
+				(access(down, j) - access(up, j)) / static_cast<float>(std::max(down - up, 1)),
+				(access(i, right) - access(i, left)) / static_cast<float>(std::max(right - left, 1)),
+				-1.0f));
+		}
+	};
+
+	/*!
+	*  \brief Source policy for point lists: point i and its three successors form one quad, drawn as two triangles
+	*  (six vertices) with one normal per triangle. The points are read in place, wherever they are stored.
+	*/
+	struct PointListSource
+	{
+		static const size_t VERTICES = 6;
+		static const size_t NORMALS = 2;
+
+		const glm::vec3* points;
+		size_t count;
+
+		PointListSource(const glm::vec3* points_, size_t count_) : points(points_), count(count_) {}
+		explicit PointListSource(const std::vector<glm::vec3>& points_) : points(points_.data()), count(points_.size()) {}
+
+		size_t units() const { return count > 3 ? count - 3 : 0; }
+
+		void emit(size_t unit, glm::vec3* vertex, glm::vec3* normal) const
+		{
+			const glm::vec3& a = points[unit];
+			const glm::vec3& b = points[unit + 1];
+			const glm::vec3& c = points[unit + 2];
+			const glm::vec3& d = points[unit + 3];
+
+			vertex[0] = a;
+			vertex[1] = b;
+			vertex[2] = c;
+
+			vertex[3] = b;
+			vertex[4] = d;
+			vertex[5] = c;
+
+			normal[0] = glm::normalize(glm::cross(b - a, c - a));
+			normal[1] = glm::normalize(glm::cross(d - b, c - b));
+		}
+	};
+
+	/*!
+	*  \brief Serially builds units [begin, end) of 'source' into the presized arrays at 'vertex' and 'normal'.
+	*/
+	template<typename Source>
+	void buildMeshRange(const Source& source, size_t begin, size_t end, glm::vec3* vertex, glm::vec3* normal)
+	{
+		for (size_t unit = begin; unit < end; ++unit, vertex += Source::VERTICES, normal += Source::NORMALS)
+			source.emit(unit, vertex, normal);
+	}
+
+	/*!
+	*  \brief Builds units [begin, end) of 'source' into 'vertices' and 'normals', which must have room for the
+	*  whole range, e.g. a mapped GPU buffer. Large ranges are split into one slice per worker, each writing its
+	*  own part of the arrays. Bounds come from the source data instead, see PointStatistics.h.
+	*/
+	template<typename Source>
+	void buildMesh(const Source& source, size_t begin, size_t end, glm::vec3* vertices, glm::vec3* normals)
+	{
+		const size_t count = end - begin;
+		const size_t slices = std::max<size_t>(1, std::min<size_t>(workerCount(), count / MESH_BUILD_GRAIN));
+		parallelFor(0, slices, 1, [&](size_t first, size_t last)
+		{
+			for (size_t s = first; s < last; ++s)
+			{
+				const size_t offset = count * s / slices, next = count * (s + 1) / slices;
+				buildMeshRange(source, begin + offset, begin + next,
+					vertices + offset * Source::VERTICES, normals + offset * Source::NORMALS);
+			}
+		});
+	}
+
+	/*!
+	*  \brief Builds units [begin, end) of 'source' into 'vertices' and 'normals', resized to exactly fit.
+	*/
+	template<typename Source>
+	void buildMesh(const Source& source, size_t begin, size_t end, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals)
+	{
+		vertices.resize((end - begin) * Source::VERTICES);
+		normals.resize((end - begin) * Source::NORMALS);
+		buildMesh(source, begin, end, vertices.data(), normals.data());
+	}
+}
@@ -0,0 +1,62 @@
+/*
+*	MortonOrder.h -- Reorders points along a Z-order (Morton) curve through their bounding box, so points that are
+*	close in space are close in memory. Consecutive ranges then have tight bounds (see Frustum.h), vertex fetches
+*	stay in cache, and spatial queries can work on contiguous ranges.
+*	The codes are sorted with a parallel LSD radix sort on the current JobSystem.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "PointColumns.h"
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Bits per axis of a Morton code; the three axes interleave into 63 bits.
+	*/
+	const unsigned int MORTON_BITS = 21;
+
+	/*!
+	*  \brief Interleaves the low MORTON_BITS bits of the cell coordinates x, y and z, x in the lowest bit.
+	*/
+	uint64_t mortonCode(uint64_t x, uint64_t y, uint64_t z);
+
+	/*!
+	*  \brief Bounds of those of 'count' points whose coordinates are all finite, computed in parallel. Returns
+	*  false if there are none.
+	*/
+	bool finiteBounds(const glm::vec3* points, size_t count, glm::vec3& min, glm::vec3& max);
+
+	/*!
+	*  \brief Morton codes of 'count' points quantized to 2^21 steps per axis of the box [min, max]. Points outside
+	*  the box, and non-finite coordinates, are clamped to its faces.
+	*/
+	void computeMortonCodes(const glm::vec3* points, size_t count, const glm::vec3& min, const glm::vec3& max, uint64_t* codes);
+
+	/*!
+	*  \brief Stable radix sort of 'keys': order[i] is the index of the i-th smallest key. Byte positions where every
+	*  key has the same digit are skipped, so codes of a cloud that spans few cells sort in fewer passes.
+	*/
+	void radixSortOrder(const uint64_t* keys, size_t count, std::vector<size_t>& order);
+
+	/*!
+	*  \brief Order of 'count' points along the Morton curve through their bounds. Returns false, leaving 'order'
+	*  empty, if they already are in that order.
+	*/
+	bool mortonOrder(const glm::vec3* points, size_t count, std::vector<size_t>& order);
+
+	/*!
+	*  \brief Permutes 'points', or every column of 'columns', so that element i becomes the old element order[i].
+	*/
+	void applyOrder(const std::vector<size_t>& order, std::vector<glm::vec3>& points);
+	void applyOrder(const std::vector<size_t>& order, PointColumns& columns);
+
+	/*!
+	*  \brief Sorts 'points' into Morton order, together with 'columns' if they describe the same points.
+	*  Returns false if nothing had to move.
+	*/
+	bool sortMorton(std::vector<glm::vec3>& points, PointColumns* columns = nullptr);
+}
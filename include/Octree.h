@@ -0,0 +1,110 @@
+/*
+*	Octree.h -- Level-of-detail octree (<source>.pcvoctree) built once from a cloud and memory-mapped at runtime.
+*	Every node keeps a subsample of the points in its cube, at most one per cell of a grid whose spacing halves
+*	with each level, and its children hold the rest. Drawing a node together with its ancestors therefore shows
+*	the cloud at that node's spacing, and a renderer can refine it node by node without ever holding all points.
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MappedFile.h"
+
+namespace PointcloudVisualizer
+{
+	class Octree
+	{
+	public:
+
+		/*!
+		*  \brief Fixed-size file header, followed by nodeCount Node records and then by the points of every
+		*  node, 64-byte aligned. Nodes are stored depth first, so the points of a subtree are contiguous.
+		*/
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t nodeCount;
+			uint64_t pointCount;
+			uint64_t sourceSize;
+			int64_t sourceTime;
+			uint64_t sourceChecksum;
+			uint64_t nodesOffset;
+			uint64_t pointsOffset;
+		};
+
+		/*!
+		*  \brief One cube of the tree. 'spacing' is the cell size of the node's subsample grid, 'first' indexes
+		*  the node's own points, children are -1 if absent.
+		*/
+		struct Node
+		{
+			float center[3];
+			float halfSize;
+			float spacing;
+			uint32_t depth;
+			uint64_t first;
+			uint64_t count;
+			int32_t children[8];
+		};
+
+		/*!
+		*  \brief Grid cells per axis of each node's subsample, and the point count at which a node stops
+		*  being split.
+		*/
+		static const unsigned int SAMPLE_GRID = 128;
+		static const size_t LEAF_POINTS = 1u << 16;
+		static const unsigned int MAX_DEPTH = 20;
+
+		/*!
+		*  \brief Path of the octree built for a source file.
+		*/
+		static std::string octreePath(const std::string& sourceFilename);
+
+		/*!
+		*  \brief Builds the octree of 'points' and writes it next to the source file, to a temporary file that is
+		*  renamed once complete. 'points' is reordered in the process.
+		*/
+		static bool build(const std::string& sourceFilename, std::vector<glm::vec3>& points);
+
+		/*!
+		*  \brief Loads a pcd or csv file (through its cache if there is one) and builds its octree.
+		*/
+		static bool buildFromSource(const std::string& sourceFilename);
+
+		/*!
+		*  \brief True if the octree of a source file exists and was built from its current version.
+		*/
+		static bool isCurrent(const std::string& sourceFilename);
+
+		/*!
+		*  \brief Maps the octree of a source file. Returns false if it is missing, stale or damaged.
+		*/
+		bool open(const std::string& sourceFilename);
+
+		void close();
+
+		bool isOpen() const { return file != nullptr; }
+		size_t nodeCount() const { return header ? header->nodeCount : 0; }
+		size_t pointCount() const { return header ? static_cast<size_t>(header->pointCount) : 0; }
+		const Node& node(size_t index) const { return nodes[index]; }
+
+		/*!
+		*  \brief Points of a node inside the mapping, valid until close().
+		*/
+		const glm::vec3* points(const Node& node) const;
+
+		/*!
+		*  \brief Pages the points of a node in from disk. Safe to call from any thread.
+		*/
+		void prefetch(const Node& node) const;
+
+	private:
+		std::unique_ptr<MappedFile> file;
+		const Header* header = nullptr;
+		const Node* nodes = nullptr;
+	};
+}
@@ -0,0 +1,104 @@
+/*
+*	OctreeCloud.h -- Renders a cloud through its level-of-detail octree (see Octree.h) without loading all of it.
+*	Every frame the visible nodes are refined coarse to fine in order of their projected point spacing until that
+*	spacing drops below a pixel threshold or the point budget is spent. Selected nodes are paged in from the mapped
+*	octree file by jobs on the JobSystem, uploaded within the per-frame upload budget, and kept on the GPU in an LRU
+*	cache so moving the camera back and forth does not read them again.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "MemoryBudget.h"
+#include "Octree.h"
+
+namespace PointcloudVisualizer
+{
+	class OctreeCloud
+	{
+	public:
+		glm::vec3 position = glm::vec3(0);
+		glm::vec3 scale = glm::vec3(1);
+		glm::vec3 rotation = glm::vec3(0);
+		glm::vec3 cloud_color = glm::vec3(1);
+		bool visible = true;
+
+		/*!
+		*  \brief Nodes are refined while their point spacing projects to more than this many pixels.
+		*/
+		float maxScreenError = 2.0f;
+
+		/*!
+		*  \brief Bytes of node buffers kept on the GPU. Nodes not drawn in the current frame are evicted least
+		*  recently drawn first once it is exceeded.
+		*/
+		size_t cacheBytes = 512u << 20;
+
+		OctreeCloud() {}
+		~OctreeCloud();
+
+		OctreeCloud(const OctreeCloud&) = delete;
+		OctreeCloud& operator=(const OctreeCloud&) = delete;
+
+		/*!
+		*  \brief Maps the octree built for a source file. Returns false if it is missing or stale.
+		*/
+		bool open(const std::string& sourceFilename);
+
+		/*!
+		*  \brief Selects the nodes to draw this frame, takes their points from 'pointBudget', starts paging in the
+		*  ones not loaded yet and uploads the paged-in ones within 'budgetBytes'.
+		*/
+		void update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+			size_t& pointBudget, size_t& budgetBytes);
+
+		/*!
+		*  \brief Draws the selected nodes that are on the GPU. Missing nodes show through their ancestors.
+		*/
+		void draw() const;
+
+		/*!
+		*  \brief Waits for pending page-ins and deletes every node buffer, also done on destruction.
+		*/
+		void release();
+
+		const Octree& tree() const { return octree; }
+		size_t drawnPoints() const { return drawnCount; }
+		size_t gpuBytes() const { return residentBytes; }
+
+	private:
+		struct NodeState
+		{
+			unsigned int VAO = 0;
+			unsigned int VBO = 0;
+
+			// Pages the node in. Still set once done, until the node is uploaded.
+			JobSystem::Handle load;
+			size_t lastUsed = 0;
+		};
+
+		Octree octree;
+		std::vector<NodeState> states;
+		std::vector<uint32_t> selected;
+		std::vector<uint32_t> drawList;
+		std::vector<uint32_t> loading;
+		MemoryBudget cache;
+		size_t frame = 0;
+		size_t drawnCount = 0;
+		size_t residentBytes = 0;
+
+		void Upload(uint32_t index, size_t& budgetBytes);
+
+		/*!
+		*  \brief Deletes the buffers of nodes not used this frame, least recently used first, until the resident
+		*  nodes fit cacheBytes.
+		*/
+		void EvictNodes();
+	};
+}
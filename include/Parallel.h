@@ -0,0 +1,21 @@
+/*
+*	Parallel.h -- Fork/join helpers for splitting loops across the threads of the current JobSystem.
+*/
+
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Number of threads parallelFor splits work across (JobSystem::current().threadCount()).
+	*/
+	unsigned int workerCount();
+
+	/*!
+	*  \brief Splits [begin, end) into contiguous ranges of at least 'grain' items and runs body(rangeBegin, rangeEnd)
+	*  for each as jobs of the current JobSystem. Returns once every range is done. Small loops run inline on the caller.
+	*/
+	void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+}
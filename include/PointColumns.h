@@ -0,0 +1,112 @@
+/*
+*	PointColumns.h -- Typed struct-of-arrays storage for per-point attributes (x, y, z, rgb, intensity, normals...).
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Description of one per-point attribute in PCD terms: element SIZE in bytes, TYPE ('F' float,
+	*  'I' signed, 'U' unsigned) and COUNT of elements per point.
+	*/
+	struct FieldSchema
+	{
+		std::string name;
+		unsigned int size = 4;
+		char type = 'F';
+		unsigned int count = 1;
+
+		size_t stride() const { return static_cast<size_t>(size) * count; }
+	};
+
+	/*!
+	*  \brief Allocator whose storage starts on an 'Alignment'-byte boundary.
+	*/
+	template<typename T, size_t Alignment>
+	struct AlignedAllocator
+	{
+		using value_type = T;
+		template<typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+		AlignedAllocator() = default;
+		template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+		T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+		void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+		template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+		template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+	};
+
+	class PointColumns
+	{
+	public:
+
+		/*!
+		*  \brief Allocates exactly 'points' entries for every field, discarding any previous contents.
+		*  With packed set, columns are laid back to back in FIELDS order (the PCD binary_compressed layout),
+		*  otherwise every column starts on a 64-byte boundary. The SIMD kernels use unaligned loads and do not rely
+		*  on it.
+		*/
+		void allocate(const std::vector<FieldSchema>& schema, size_t points, bool packed = false);
+
+		/*!
+		*  \brief True if the packed layout keeps every column naturally aligned for its element type.
+		*/
+		static bool packedLayoutIsAligned(const std::vector<FieldSchema>& schema, size_t points);
+
+		void clear();
+
+		/*!
+		*  \brief Shrinks the logical point count without moving any column, e.g. when a body holds fewer
+		*  points than its header announced.
+		*/
+		void truncate(size_t points) { if (points < pointCount) pointCount = points; }
+
+		size_t size() const { return pointCount; }
+		size_t fieldCount() const { return fields.size(); }
+		const std::vector<FieldSchema>& schema() const { return fields; }
+		const FieldSchema& field(int i) const { return fields[i]; }
+		int find(const std::string& name) const;
+
+		char* column(int i) { return block.data() + offsets[i]; }
+		const char* column(int i) const { return block.data() + offsets[i]; }
+		size_t columnBytes(int i) const { return pointCount * fields[i].stride(); }
+
+		/*!
+		*  \brief The whole backing allocation, e.g. to decompress a packed body straight into.
+		*/
+		char* raw() { return block.data(); }
+		size_t rawBytes() const { return block.size(); }
+
+		/*!
+		*  \brief Typed view of a column. T must match the field's SIZE/TYPE.
+		*/
+		template<typename T> T* data(int i) { return reinterpret_cast<T*>(column(i)); }
+		template<typename T> const T* data(int i) const { return reinterpret_cast<const T*>(column(i)); }
+
+		/*!
+		*  \brief Reads/writes one element of any SIZE/TYPE, converting through double.
+		*/
+		double get(int i, size_t point, unsigned int element = 0) const;
+		void set(int i, size_t point, unsigned int element, double value);
+
+		/*!
+		*  \brief Interleaves the x/y/z columns into positions. Returns false if a coordinate field is missing.
+		*/
+		bool gatherPositions(std::vector<glm::vec3>& positions) const;
+
+	private:
+		std::vector<FieldSchema> fields;
+		std::vector<size_t> offsets;
+		std::vector<char, AlignedAllocator<char, 64>> block;
+		size_t pointCount = 0;
+	};
+}
@@ -0,0 +1,35 @@
+/*
+*	PointFilters.h -- Filters that thin out a cloud before it is uploaded.
+*	Voxel-grid downsampling keeps one point per occupied cube of a regular grid, so clouds much denser than the
+*	screen can resolve are drawn with a fraction of the points. Statistical outlier removal drops the isolated
+*	points sensors scatter around a scan, which waste fill rate and inflate the bounds used for framing.
+*/
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Point voxelDownsample() keeps for each voxel: the centroid of its points, or the first of them.
+	*/
+	enum class VoxelMode { Centroid, First };
+
+	/*!
+	*  \brief Writes one point per occupied cube of a grid with 'voxelSize' sides, anchored at the bounds of the
+	*  cloud, to 'output' in Morton order of the voxels. Points with non-finite coordinates are dropped. Returns
+	*  false, leaving 'output' alone, if the voxel size is not positive or the grid would be finer than
+	*  2^21 voxels along an axis.
+	*/
+	bool voxelDownsample(const glm::vec3* points, size_t count, float voxelSize, VoxelMode mode, std::vector<glm::vec3>& output);
+
+	/*!
+	*  \brief Writes the points whose mean distance to their 'neighbours' nearest neighbours is at most 'sigma'
+	*  standard deviations above the mean of that distance over the cloud to 'output', in their original order.
+	*  The neighbours are found in parallel through a KdTree. Points with non-finite coordinates are dropped.
+	*  Returns false, leaving 'output' alone, if 'neighbours' is 0 or the tree cannot be built.
+	*/
+	bool removeOutliers(const glm::vec3* points, size_t count, unsigned int neighbours, float sigma, std::vector<glm::vec3>& output);
+}
@@ -0,0 +1,55 @@
+/*
+*	PointStatistics.h -- Minimum, maximum, mean and variance of point coordinates and attribute columns.
+*	The reductions run over contiguous floats with SSE2, AVX2 or AVX-512 (see CpuFeatures.h), split across workers.
+*/
+
+#pragma once
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace PointcloudVisualizer
+{
+	/*!
+	*  \brief Statistics of one column of values. The variance is the population variance.
+	*/
+	struct ColumnStatistics
+	{
+		size_t count = 0;
+		float min = 0;
+		float max = 0;
+		double mean = 0;
+		double variance = 0;
+
+		/*!
+		*  \brief Combines these statistics with those of a disjoint set of values.
+		*/
+		void merge(const ColumnStatistics& other);
+	};
+
+	/*!
+	*  \brief Per-axis statistics of a set of points.
+	*/
+	struct PointStatistics
+	{
+		ColumnStatistics x, y, z;
+
+		size_t count() const { return x.count; }
+		glm::vec3 min() const { return glm::vec3(x.min, y.min, z.min); }
+		glm::vec3 max() const { return glm::vec3(x.max, y.max, z.max); }
+		glm::vec3 mean() const { return glm::vec3(x.mean, y.mean, z.mean); }
+		glm::vec3 variance() const { return glm::vec3(x.variance, y.variance, z.variance); }
+		glm::vec3 extent() const { return max() - min(); }
+
+		void merge(const PointStatistics& other);
+	};
+
+	/*!
+	*  \brief Statistics of 'count' contiguous floats, e.g. one column of a PointColumns store.
+	*/
+	ColumnStatistics computeColumnStatistics(const float* values, size_t count);
+
+	/*!
+	*  \brief Statistics of the x, y and z coordinates of 'count' interleaved points.
+	*/
+	PointStatistics computeStatistics(const glm::vec3* points, size_t count);
+}
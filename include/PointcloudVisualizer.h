@@ -9,6 +9,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include <glad/glad.h>
@@ -20,6 +21,14 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "CloudLoader.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "KdTree.h"
+#include "MemoryBudget.h"
+#include "OctreeCloud.h"
+#include "PointStatistics.h"
+#include "StreamingBuffer.h"
 
 namespace PointcloudVisualizer
 {
@@ -183,17 +192,46 @@ namespace PointcloudVisualizer
 			std::vector<std::vector<float>> dataSTL;
 			std::vector<glm::vec3> dataGLM;
 			//af::array dataAF;//currently, OpenGL has issues with Arrayfire's JIT compiler and won't work.
-			unsigned int VAO, VBO, VBO2, drawCount;
+			unsigned int VAO, VBO, VBO2, EBO, drawCount, indexCount;
 			glm::vec3 position;
 			glm::vec3 scale;
 			glm::vec3 rotation;
 			glm::vec3 cloud_color;
 
+			/*!
+			*  \brief Depth images (CV and STL data) upload every sample once and draw as points. When set, they
+			*  also get an element buffer connecting neighbouring samples and draw as triangles instead.
+			*/
+			bool triangles = false;
+
+			/*!
+			*  \brief For clouds that change every frame. A streaming mesh is rebuilt as a whole whenever dataChanged()
+			*  was called, straight into the next segment of a persistently mapped ring buffer, so updates neither
+			*  reallocate GPU memory nor wait for frames still in flight.
+			*/
+			bool streaming = false;
+
+			/*!
+			*  \brief What happens to the host copy of the data once all of it is on the GPU, see MemoryBudget.h.
+			*/
+			Residency residency = Residency::Keep;
+
+			/*!
+			*  \brief Hidden meshes are neither uploaded nor drawn, and are the first the memory budget evicts.
+			*/
+			bool visible = true;
+
+			/*!
+			*  \brief Frame number of the last Draw() in which a chunk of this mesh passed frustum culling, so meshes out
+			*  of view age and are the first the memory budget evicts.
+			*/
+			size_t lastDrawnFrame = 0;
+
 			/*!
 			*  \brief OpenCV Mat initializer.
 			*/
 			CloudMesh(cv::Mat& data_) : 
-				VAO(0), VBO(0), VBO2(0), drawCount(0), 
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0), 
 				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
 				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::CV), dataCV(data_)
 			{}
@@ -202,7 +240,7 @@ namespace PointcloudVisualizer
 			*  \brief stl vector matrix initializer.
 			*/
 			CloudMesh(std::vector<std::vector<float>>& data_) :
-				VAO(0), VBO(0), VBO2(0), drawCount(0),
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0),
 				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
 				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::STL), dataSTL(data_)
 			{}
@@ -211,45 +249,247 @@ namespace PointcloudVisualizer
 			*  \brief glm vector matrix initializer.
 			*/
 			CloudMesh(std::vector<glm::vec3>& data_) :
-				VAO(0), VBO(0), VBO2(0), drawCount(0),
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0),
 				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
 				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::GLM), dataGLM(data_)
 			{}
 
 			/*!
-			*  \brief Loads data at render-time.
+			*  \brief Move initializers: the mesh takes over the caller's buffer instead of copying it.
 			*/
-			void loadVAO();
+			CloudMesh(cv::Mat&& data_) :
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0),
+				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
+				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::CV), dataCV(std::move(data_))
+			{}
+
+			CloudMesh(std::vector<std::vector<float>>&& data_) :
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0),
+				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
+				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::STL), dataSTL(std::move(data_))
+			{}
+
+			CloudMesh(std::vector<glm::vec3>&& data_) :
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0),
+				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
+				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::GLM), dataGLM(std::move(data_))
+			{}
 
 			/*!
-			*  \brief Deletes all buffers and arrays stored on the GPU.
+			*  \brief Points owned elsewhere, read in place. 'owner', if given, is held to keep them alive; otherwise
+			*  the caller keeps them valid until the mesh is destroyed or releases its host data.
+			*/
+			CloudMesh(const glm::vec3* points_, size_t count_, std::shared_ptr<const void> owner_ = nullptr) :
+				VAO(0), VBO(0), VBO2(0), EBO(0), drawCount(0), indexCount(0),
+				position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)),
+				cloud_color(glm::vec3(1)), datatype(DATA_TYPE::GLM),
+				externalPoints(points_), externalCount(count_), externalOwner(std::move(owner_))
+			{}
+
+			/*!
+			*  \brief Meshes are move-only: the GPU buffers, the streaming ring and the spill file belong to exactly
+			*  one mesh, which deletes them when it is destroyed.
+			*/
+			CloudMesh(CloudMesh&& other) noexcept;
+			CloudMesh& operator=(CloudMesh&& other) noexcept;
+			CloudMesh(const CloudMesh&) = delete;
+			CloudMesh& operator=(const CloudMesh&) = delete;
+			~CloudMesh();
+
+			/*!
+			*  \brief The points of GLM data, in dataGLM or in memory owned elsewhere.
+			*/
+			const glm::vec3* points() const { return externalPoints ? externalPoints : dataGLM.data(); }
+			size_t pointCount() const { return externalPoints ? externalCount : dataGLM.size(); }
+
+			/*!
+			*  \brief Loads data at render-time. Builds and uploads at most 'budgetBytes' of vertex data, continuing
+			*  where the previous call stopped, and subtracts what it used. The GPU buffers are allocated for the whole
+			*  mesh up front, so a partially uploaded mesh already draws the part that has arrived.
+			*/
+			void loadVAO(size_t& budgetBytes);
+
+			/*!
+			*  \brief Draws the uploaded data chunk by chunk: consecutive runs of 16384 units (bands of whole rows of
+			*  about as many samples for depth images) whose bounds intersect 'frustum', merged into as few ranges as possible.
+			*/
+			void draw(const Frustum& frustum);
+
+			/*!
+			*  \brief False if the mesh still has data to upload, but the bounds of all of it are known from an earlier
+			*  upload and none of them intersects 'frustum'. Chunk bounds outlive GPU eviction, so an evicted mesh out of
+			*  view is neither read back nor uploaded again until it comes into view.
+			*/
+			bool needsUpload(const Frustum& frustum);
+
+			/*!
+			*  \brief Chunks with bounds so far, and how many the last draw() submitted.
+			*/
+			size_t chunkCount() const { return chunkBounds.size(); }
+			size_t drawnChunks() const { return visibleChunks; }
+
+			/*!
+			*  \brief Call after changing the data in place. Streaming meshes are rebuilt on the next frame; others are
+			*  uploaded again within the per-frame budget, into their existing buffers unless the data grew.
+			*/
+			void dataChanged();
+
+			/*!
+			*  \brief Call after appending to dataGLM. What is uploaded stays on the GPU; only state derived from the
+			*  whole cloud, such as the spatial index, is rebuilt.
+			*/
+			void dataAppended();
+
+			/*!
+			*  \brief Fences the streaming segment the frame's draw call read. Draw() calls this after each mesh.
+			*/
+			void finishFrame();
+
+			/*!
+			*  \brief Deletes all buffers and arrays stored on the GPU. The next loadVAO() uploads the data again.
 			*/
 			void clear();
 
-			float width() {return std::abs(x_max - x_min);}
-			float height() {return std::abs(y_max - y_min);}
-			float depth() {return std::abs(z_max - z_min);}
+			/*!
+			*  \brief Bytes the data takes in host memory, 0 while it is released or spilled.
+			*/
+			size_t hostBytes() const;
+
+			/*!
+			*  \brief Bytes of GPU buffers allocated for this mesh.
+			*/
+			size_t gpuBytes() const;
+
+			/*!
+			*  \brief True once every vertex (and every triangle of a triangulated grid) is on the GPU.
+			*/
+			bool isUploaded() const;
+
+			bool hasHostData() const { return hostResident; }
+			bool isSpilled() const { return !spillPath.empty(); }
+
+			/*!
+			*  \brief Frees the host copy of a fully uploaded mesh, writing it to a spill file first if 'spill' is set.
+			*  Returns false if the mesh is not uploaded yet or the spill file could not be written.
+			*/
+			bool releaseHostData(bool spill);
+
+			/*!
+			*  \brief Reads a spilled host copy back. The spill file is kept until the data changes.
+			*/
+			bool restoreHostData();
+
+			/*!
+			*  \brief Deletes the spill file, if any.
+			*/
+			void discardSpill();
+
+			float width() {return pointStatistics.extent().x;}
+			float height() {return pointStatistics.extent().y;}
+			float depth() {return pointStatistics.extent().z;}
+
+			/*!
+			*  \brief Bounds, mean and variance of the vertex positions of all data added so far, uploaded or not.
+			*/
+			const PointStatistics& statistics() const {return pointStatistics;}
+
+			/*!
+			*  \brief KD-tree over points(), built on first use after the data changed or grew. It is empty for grid data and
+			*  while the host data is released.
+			*/
+			const KdTree& spatialIndex();
 
 		private:
+			PointStatistics pointStatistics;
+			size_t statisticsPoints = 0;
+
+			/*!
+			*  \brief Folds data that arrived since the last call into pointStatistics.
+			*/
+			void updateStatistics();
+
+			/*!
+			*  \brief Units already on the GPU and units the buffers have room for. A unit is one sample of a depth
+			*  image, or one quad of a point list. Points appended to dataGLM grow the buffers
+			*  with a GPU-side copy instead of a new upload.
+			*/
+			size_t uploadedUnits = 0;
+			size_t capacityUnits = 0;
+			size_t indexedCells = 0;
+			std::vector<glm::vec3> stagingVertices;
+			std::vector<glm::vec3> stagingNormals;
+			std::vector<unsigned int> stagingIndices;
+			size_t indexedRows = 0;
+			size_t indexedColumns = 0;
+
+			StreamingBuffer stream;
+			bool streamDirty = true;
+
+			bool hostResident = true;
+			std::string spillPath;
+
+			const glm::vec3* externalPoints = nullptr;
+			size_t externalCount = 0;
+			std::shared_ptr<const void> externalOwner;
+
+			/*!
+			*  \brief Bounds of chunks of chunkUnits units, or chunkCells grid cells when drawn as triangles, computed
+			*  from the host data as it is uploaded. They cover the first chunkedUnits units and stay valid while the
+			*  data is released or spilled.
+			*/
+			BoxList chunkBounds;
+			size_t chunkUnits = 0;
+			size_t chunkCells = 0;
+			size_t chunkedUnits = 0;
+			size_t visibleChunks = 0;
+			std::vector<unsigned char> chunkVisible;
+			std::vector<GLint> drawFirsts;
+			std::vector<GLsizei> drawCounts;
+			std::vector<const void*> drawOffsets;
+
+			KdTree kdTree;
+			bool kdTreeCurrent = false;
+
+			/*!
+			*  \brief Takes over every member of 'other', leaving it empty and owning no GL objects.
+			*/
+			void moveFrom(CloudMesh& other);
+
+			bool isGrid() const { return datatype != DATA_TYPE::GLM; }
+			size_t verticesPerUnit() const { return isGrid() ? 1 : 6; }
+			size_t normalsPerUnit() const { return isGrid() ? 1 : 2; }
+			size_t gridRows() const;
+			size_t gridColumns() const;
+
+			/*!
+			*  \brief Number of units the current data produces.
+			*/
+			size_t unitCount() const;
+
+			/*!
+			*  \brief Makes sure the VAO and both vertex buffers hold at least 'units' units, keeping the uploaded ones.
+			*/
+			void reserveUnits(size_t units);
+
 			/*!
-			*  \brief Dimensions of bounding box around the point cloud mesh.
+			*  \brief Builds the two triangles of grid cells [begin, end), numbered row by row.
 			*/
-			float x_min, x_max, y_min, y_max, z_min, z_max;
+			void buildIndices(size_t begin, size_t end);
 
 			/*!
-			*  \brief Loads data for opencv Mats.
+			*  \brief Uploads the triangles of the grid cells whose corners are uploaded, within the budget.
 			*/
-			void loadVAO_CV();
+			void loadIndices(size_t& budgetBytes);
 
 			/*!
-			*  \brief Loads data for stl std::vector<std::vector<float>> arrays.
+			*  \brief Rebuilds a changed streaming mesh into the next ring segment and points the VAO at it.
 			*/
-			void loadVAO_STL();
+			void loadStreaming(size_t& budgetBytes);
 
 			/*!
-			*  \brief Loads data for stl std::vector<glm::vec3> arrays.
+			*  \brief Computes the bounds of the chunks uploaded since the last call, redoing the last partial one.
 			*/
-			void loadVAO_GLM();
+			void updateChunks();
 		};
 
 
@@ -257,6 +497,38 @@ namespace PointcloudVisualizer
 		char keyTimer;
 		unsigned int axisVAO, axisVBO, axisVBO2;
 		glm::vec3 lightPos = glm::vec3(0);
+
+		/*!
+		*  \brief Bytes of vertex data uploaded to the GPU per frame. Large clouds fill in over several frames
+		*  instead of stalling one.
+		*/
+		size_t uploadBudget = 32u << 20;
+
+		/*!
+		*  \brief Points drawn per frame across all octrees. Each octree refines its nodes until this is spent.
+		*/
+		size_t pointBudget = 10000000;
+
+		/*!
+		*  \brief Skips the chunks of each mesh that lie outside the camera's view. Off draws every uploaded point.
+		*/
+		bool frustumCulling = true;
+
+		/*!
+		*  \brief Threads the job system splits loading, mesh building and statistics across, read by initialize().
+		*  0 uses every hardware thread.
+		*/
+		unsigned int workerThreads = 0;
+
+		/*!
+		*  \brief Residency given to meshes added from now on.
+		*/
+		Residency residency = Residency::Keep;
+
+		/*!
+		*  \brief Host and GPU memory limits. Checked after every frame.
+		*/
+		MemoryBudget memoryBudget;
 		Shader* shader;
 		GLFWwindow* window;
 
@@ -272,16 +544,81 @@ namespace PointcloudVisualizer
 
 		void initialize(int window_width, int window_height);
 
+		/*!
+		*  \brief The pool every parallel loop of this visualizer runs on, created by initialize().
+		*/
+		JobSystem& jobSystem() { return *jobs; }
+
 		void addData(cv::Mat& cloud);
 
 		void addData(std::vector<std::vector<float>>& cloud);
 	
 		void addData(std::vector<glm::vec3>& cloud);
 
+		/*!
+		*  \brief Zero-copy overloads: the new mesh takes over the caller's buffer, e.g. addData(std::move(points)).
+		*/
+		void addData(cv::Mat&& cloud);
+
+		void addData(std::vector<std::vector<float>>&& cloud);
+
+		void addData(std::vector<glm::vec3>&& cloud);
+
+		/*!
+		*  \brief Shares a point buffer with the caller. It lives as long as either side holds it.
+		*/
+		void addData(std::shared_ptr<const std::vector<glm::vec3>> cloud);
+
+		/*!
+		*  \brief Views memory owned elsewhere, which must stay valid while the mesh uses it: 'count' points, or a
+		*  depth image of rows x columns floats with 'stride' bytes per row (0 for tightly packed rows).
+		*/
+		void addData(const glm::vec3* points, size_t count);
+
+		void addData(const float* depth, int rows, int columns, size_t stride = 0);
+
+		/*!
+		*  \brief Hands the points of pcd and csv files loaded from now on over in Morton order (see MortonOrder.h),
+		*  which gives each culling chunk tight bounds.
+		*/
+		bool spatialSort = false;
+
+		/*!
+		*  \brief Downsamples pcd and csv files loaded from now on to one point per voxel of this size (see
+		*  PointFilters.h), kept as voxelMode says. 0 keeps every point.
+		*/
+		float voxelSize = 0.0f;
+		VoxelMode voxelMode = VoxelMode::Centroid;
+
+		/*!
+		*  \brief Drops points of pcd and csv files loaded from now on whose mean distance to their outlierNeighbours
+		*  nearest neighbours is more than outlierSigma standard deviations above average (see PointFilters.h),
+		*  so floating noise neither costs fill rate nor widens the framing bounds. 0 keeps every point.
+		*/
+		float outlierSigma = 0.0f;
+		unsigned int outlierNeighbours = 8;
+
+		/*!
+		*  \brief Starts loading a pointcloud file (pcd, csv or depth image) on a background thread. RenderLoop()
+		*  shows the points as batches arrive and reports progress in the window title. New meshes are placed at 'position'.
+		*/
+		void loadAsync(const std::string& filename, bool useCache = true, glm::vec3 position = glm::vec3(0));
+
+		/*!
+		*  \brief Adds a cloud drawn level of detail through the octree built for 'filename' (see Octree::buildFromSource),
+		*  streamed from disk as the camera moves. Returns nullptr if there is no current octree.
+		*/
+		OctreeCloud* addOctree(const std::string& filename, glm::vec3 position = glm::vec3(0));
+
+		/*!
+		*  \brief Stops a background load, keeping the points that already arrived.
+		*/
+		void cancelLoading();
+
 
 		void Draw() {
 			// Check to see if there is anything saved to draw.
-			if (this->meshes.size() <= 0) { return; }
+			if (this->meshes.size() <= 0 && this->octrees.empty()) { return; }
 
 			// Set all necessary global GL states.
 			glDisable(GL_CULL_FACE);
@@ -294,23 +631,71 @@ namespace PointcloudVisualizer
 			shader->setVec3("viewPos", camera.Position);
 			shader->setVec3("lightPos", this->lightPos);
 
-			// Draw all saved cloud meshes.
+			// Draw all visible cloud meshes, uploading at most uploadBudget bytes of new vertices this frame.
+			size_t budget = uploadBudget;
+			++frameIndex;
+			const glm::mat4 viewProjection = projection * camera.GetViewMatrix();
 			for (int i = 0; i < meshes.size(); ++i) {
-				meshes[i].loadVAO();
-				shader->setMat4("model", transformMatrix(meshes[i].position, meshes[i].scale, meshes[i].rotation));
+				if (!meshes[i].visible) { continue; }
+				glm::mat4 model = transformMatrix(meshes[i].position, meshes[i].scale, meshes[i].rotation);
+				const Frustum frustum = frustumCulling ? Frustum(viewProjection * model) : Frustum();
+				if (!meshes[i].needsUpload(frustum)) { continue; }
+				meshes[i].loadVAO(budget);
+				shader->setMat4("model", model);
 				shader->setVec3("cloud_color", this->meshes[i].cloud_color);
-				glBindVertexArray(meshes[i].VAO);
-				glDrawArrays(GL_POINTS, 0, meshes[i].drawCount);
+				meshes[i].draw(frustum);
+				if (meshes[i].drawnChunks() > 0) { meshes[i].lastDrawnFrame = frameIndex; }
+				meshes[i].finishFrame();
+			}
+
+			// Octrees share the upload budget with the meshes and split the point budget between them.
+			size_t points = pointBudget;
+			for (const std::unique_ptr<OctreeCloud>& octree : octrees) {
+				glm::mat4 model = transformMatrix(octree->position, octree->scale, octree->rotation);
+				octree->update(model, camera.GetViewMatrix(), projection, (float)window_height, points, budget);
+				shader->setMat4("model", model);
+				shader->setVec3("cloud_color", octree->cloud_color);
+				octree->draw();
 			}
 
 			glBindVertexArray(0);
+			EnforceMemoryBudget();
 		}
 
 		void RenderLoop();
 
 		private:
 			int window_width, window_height;
+			glm::mat4 projection;
 			void saveFramebufferToFile(GLuint buff=0, std::string filename="", std::string format="JPG");
+
+			// Declared before the loader so its worker thread is joined while the pool still exists.
+			std::unique_ptr<JobSystem> jobs;
+			CloudLoader loader;
+
+			// Declared after the pool as well, their page-in jobs finish before it is destroyed.
+			std::vector<std::unique_ptr<OctreeCloud>> octrees;
+			bool loadActive = false;
+			bool firstPixelPending = false;
+			int loadingMesh = -1;
+			glm::vec3 loadPosition = glm::vec3(0);
+			double loadStartTime = 0;
+			double lastTitleUpdate = 0;
+
+			size_t frameIndex = 0;
+			bool budgetWarned = false;
+
+			/*!
+			*  \brief Applies each mesh's residency policy, then evicts meshes not drawn this frame while the memory
+			*  budget is exceeded: host data is spilled, GPU buffers of meshes that can be uploaded again are deleted.
+			*/
+			void EnforceMemoryBudget();
+
+			/*!
+			*  \brief Takes the batches the loader finished since the last frame and appends them to the loading mesh,
+			*  whose new points Draw() then uploads within the per-frame budget.
+			*/
+			void PollLoader();
 	};
 }// END NAMESPACE
 #endif
\ No newline at end of file
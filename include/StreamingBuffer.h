@@ -0,0 +1,82 @@
+/*
+*	StreamingBuffer.h -- Ring of vertex buffer segments for data rewritten every frame.
+*	With GL 4.4 the buffer is allocated once with glBufferStorage and stays persistently and coherently mapped,
+*	so the CPU writes straight into GPU-visible memory. Each segment is fenced after the draws that read it and
+*	only rewritten once the GPU is done with it, so neither side waits while the others are in flight.
+*	Older contexts get the same ring filled with glBufferSubData.
+*/
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+
+namespace PointcloudVisualizer
+{
+	class StreamingBuffer
+	{
+	public:
+
+		/*!
+		*  \brief Segments in the ring: one being written, up to two still read by frames the GPU has queued.
+		*/
+		static const unsigned int SEGMENTS = 3;
+
+		StreamingBuffer() {}
+		~StreamingBuffer();
+
+		/*!
+		*  \brief The ring is move-only: exactly one StreamingBuffer owns the GL buffer and fences.
+		*/
+		StreamingBuffer(StreamingBuffer&& other) noexcept;
+		StreamingBuffer& operator=(StreamingBuffer&& other) noexcept;
+		StreamingBuffer(const StreamingBuffer&) = delete;
+		StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+		/*!
+		*  \brief Allocates the ring with room for 'segmentBytes' per segment, releasing any previous one.
+		*  Returns false if the buffer could not be created.
+		*/
+		bool allocate(size_t segmentBytes);
+
+		/*!
+		*  \brief Unmaps and deletes the buffer and its fences, also done on destruction.
+		*/
+		void release();
+
+		/*!
+		*  \brief Moves to the next segment, waits until the GPU has finished reading it, and returns where to
+		*  write up to segmentBytes() of data. Call endWrite() afterwards.
+		*/
+		void* beginWrite();
+
+		/*!
+		*  \brief Publishes 'bytes' written since beginWrite() and returns their byte offset in buffer().
+		*/
+		size_t endWrite(size_t bytes);
+
+		/*!
+		*  \brief Fences the segment last written. Call after each frame's draws that read it have been issued.
+		*/
+		void fence();
+
+		unsigned int buffer() const { return id; }
+		size_t segmentBytes() const { return segmentSize; }
+
+		/*!
+		*  \brief True if the ring is persistently mapped, false if it falls back to glBufferSubData.
+		*/
+		bool persistent() const { return mapped != nullptr; }
+
+	private:
+		unsigned int id = 0;
+		size_t segmentSize = 0;
+		unsigned int current = 0;
+		bool written = false;
+		char* mapped = nullptr;
+		std::vector<GLsync> fences;
+
+		// Written by the CPU before glBufferSubData when the buffer is not mapped.
+		std::vector<char> staging;
+	};
+}
@@ -1,9 +1,23 @@
 #pragma once
 #include "stdafx.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace PointcloudVisualizer
 {
 	std::vector<std::string> tokenize(std::string toTokenize, std::string token);	
+
+	/*!
+	*  \brief Splits text at runs of any of the delimiter characters, like tokenize(), but returns views into
+	*  the original buffer instead of copies. Delimiter positions are found 16 or 32 bytes at a time with
+	*  SSE2/AVX2, as selected by simdLevel(). Re-entrant; the only allocation is growth of 'tokens', which is cleared first so it can be
+	*  reused across lines. Returns the number of tokens.
+	*/
+	size_t tokenizeView(std::string_view text, std::string_view delimiters, std::vector<std::string_view>& tokens);
+
+	/*!
+	*  \brief Returns the first position in [begin, end) holding any of the characters, or end.
+	*/
+	const char* findFirstOf(const char* begin, const char* end, std::string_view characters);
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "AsciiParser.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		inline bool IsSeparator(char c, char delimiter)
+		{
+			return c == delimiter || c == ' ' || c == '\t' || c == '\r';
+		}
+
+		inline const char* LineEnd(const char* cursor, const char* end)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+			return newline ? newline : end;
+		}
+
+		template<typename RowFunction>
+		void ForEachRow(const char* begin, const char* end, char delimiter, RowFunction onRow)
+		{
+			while (begin < end)
+			{
+				const char* lineEnd = LineEnd(begin, end);
+				if (AsciiChunkParser::isDataRow(begin, lineEnd, delimiter) && !onRow(begin, lineEnd))
+					return;
+				begin = lineEnd < end ? lineEnd + 1 : end;
+			}
+		}
+	}
+
+	AsciiChunkParser::AsciiChunkParser(const char* begin, const char* end, char delimiter_, size_t columns_) :
+		delimiter(delimiter_), columns(columns_)
+	{
+		if (end <= begin)
+		{
+			chunkBegins.push_back(end);
+			return;
+		}
+
+		// Cut at the first newline after every nominal boundary, keeping at least 64 KiB per chunk.
+		const size_t bytes = end - begin;
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(workerCount(), bytes / (64 * 1024)));
+		chunkBegins.push_back(begin);
+		for (size_t i = 1; i < chunkCount; ++i)
+		{
+			const char* cut = std::max(begin + bytes * i / chunkCount, chunkBegins.back());
+			cut = LineEnd(cut, end);
+			if (cut < end)
+				++cut;
+			if (cut > chunkBegins.back() && cut < end)
+				chunkBegins.push_back(cut);
+		}
+		chunkBegins.push_back(end);
+
+		// Count rows per chunk in parallel, then prefix-sum into each chunk's first output row.
+		const size_t chunks = chunkBegins.size() - 1;
+		std::vector<size_t> counts(chunks, 0);
+		parallelFor(0, chunks, 1, [&](size_t first, size_t last)
+		{
+			for (size_t c = first; c < last; ++c)
+				ForEachRow(chunkBegins[c], chunkBegins[c + 1], delimiter, [&](const char*, const char*) { ++counts[c]; return true; });
+		});
+
+		chunkFirstRow.resize(chunks);
+		for (size_t c = 0; c < chunks; ++c)
+		{
+			chunkFirstRow[c] = totalRows;
+			totalRows += counts[c];
+		}
+	}
+
+	void AsciiChunkParser::parse(const AsciiRowWriter& writer, size_t maxRows) const
+	{
+		const size_t chunks = chunkFirstRow.size();
+		parallelFor(0, chunks, 1, [&](size_t first, size_t last)
+		{
+			std::vector<double> values(std::max<size_t>(columns, 1));
+			for (size_t c = first; c < last; ++c)
+			{
+				size_t row = chunkFirstRow[c];
+				ForEachRow(chunkBegins[c], chunkBegins[c + 1], delimiter, [&](const char* lineBegin, const char* lineEnd)
+				{
+					if (row >= maxRows)
+						return false;
+					size_t found = parseLine(lineBegin, lineEnd, delimiter, values.data(), columns);
+					std::fill(values.begin() + found, values.begin() + columns, 0.0);
+					writer(row++, values.data());
+					return true;
+				});
+			}
+		});
+	}
+
+	size_t AsciiChunkParser::parseLine(const char* begin, const char* end, char delimiter, double* values, size_t columns)
+	{
+		// from_chars stops on the separator after a number, so the skipping below is a byte or two per field. That
+		// is faster than splitting the row with tokenizeView() first (see the tokenizer benchmark in bench/).
+		size_t found = 0;
+		while (found < columns)
+		{
+			while (begin < end && IsSeparator(*begin, delimiter))
+				++begin;
+			if (begin >= end)
+				break;
+
+			// from_chars rejects an explicit '+' sign, which some exporters write.
+			if (*begin == '+')
+				++begin;
+
+			double value = 0;
+			std::from_chars_result result = std::from_chars(begin, end, value);
+			values[found++] = result.ec == std::errc() ? value : 0.0;
+
+			begin = result.ptr;
+			while (begin < end && !IsSeparator(*begin, delimiter))
+				++begin;
+		}
+
+		return found;
+	}
+
+	bool AsciiChunkParser::isDataRow(const char* begin, const char* end, char delimiter)
+	{
+		while (begin < end && IsSeparator(*begin, delimiter))
+			++begin;
+		return begin < end && *begin != '#';
+	}
+}
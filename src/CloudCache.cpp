@@ -0,0 +1,261 @@
+#include "CloudCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "PointStatistics.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		const char CACHE_MAGIC[8] = { 'P', 'C', 'V', 'C', 'A', 'C', 'H', 'E' };
+		const uint32_t CACHE_VERSION = 1;
+		const size_t CACHE_ALIGNMENT = 64;
+		const size_t SIGNATURE_SAMPLE = 1u << 20;
+
+		size_t AlignUp(size_t offset)
+		{
+			return (offset + CACHE_ALIGNMENT - 1) & ~(CACHE_ALIGNMENT - 1);
+		}
+
+		uint64_t Fnv1a(const char* data, size_t size, uint64_t hash)
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= static_cast<unsigned char>(data[i]);
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		void WritePadding(std::ofstream& out, size_t target)
+		{
+			static const char zeros[CACHE_ALIGNMENT] = {};
+			size_t position = static_cast<size_t>(out.tellp());
+			if (target > position)
+				out.write(zeros, target - position);
+		}
+	}
+
+	std::string CloudCache::cachePath(const std::string& sourceFilename)
+	{
+		return sourceFilename + ".pcvcache";
+	}
+
+	bool CloudCache::sourceSignature(const std::string& sourceFilename, uint64_t& size, int64_t& time, uint64_t& checksum)
+	{
+		std::error_code error;
+		size = std::filesystem::file_size(sourceFilename, error);
+		if (error)
+			return false;
+		auto writeTime = std::filesystem::last_write_time(sourceFilename, error);
+		if (error)
+			return false;
+		time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+
+		std::ifstream in(sourceFilename, std::ios::binary | std::ios::in);
+		std::vector<char> sample(static_cast<size_t>(std::min<uint64_t>(size, SIGNATURE_SAMPLE)));
+		in.read(sample.data(), sample.size());
+		checksum = Fnv1a(sample.data(), static_cast<size_t>(in.gcount()), 14695981039346656037ull);
+		if (size > SIGNATURE_SAMPLE)
+		{
+			in.seekg(static_cast<std::streamoff>(size - sample.size()));
+			in.read(sample.data(), sample.size());
+			checksum = Fnv1a(sample.data(), static_cast<size_t>(in.gcount()), checksum);
+		}
+		return true;
+	}
+
+	bool CloudCache::write(const std::string& sourceFilename, const std::vector<glm::vec3>& positions)
+	{
+		Header header = {};
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = CACHE_VERSION;
+		header.pointCount = positions.size();
+		if (!sourceSignature(sourceFilename, header.sourceSize, header.sourceTime, header.sourceChecksum))
+			return false;
+
+		PointStatistics statistics = computeStatistics(positions.data(), positions.size());
+		const glm::vec3 lo = statistics.min(), hi = statistics.max();
+		for (int i = 0; i < 3; ++i)
+		{
+			header.boundsMin[i] = lo[i];
+			header.boundsMax[i] = hi[i];
+		}
+
+		// Only positions are cached, since nothing reads the other fields of a cloud; they start 64-byte aligned.
+		header.positionsOffset = AlignUp(sizeof(Header));
+
+		const std::string path = cachePath(sourceFilename);
+		const std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream out(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			if (!out.is_open())
+			{
+				std::cerr << "WARNING: Could not write cache file: " << temporaryPath << std::endl;
+				return false;
+			}
+
+			out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			WritePadding(out, header.positionsOffset);
+			if (!positions.empty())
+				out.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(glm::vec3));
+
+			if (!out.good())
+			{
+				out.close();
+				std::remove(temporaryPath.c_str());
+				std::cerr << "WARNING: Could not write cache file: " << temporaryPath << std::endl;
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	bool CloudCache::Writer::begin(const std::string& sourceFilename)
+	{
+		abandon();
+		header = {};
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = CACHE_VERSION;
+		header.positionsOffset = AlignUp(sizeof(Header));
+		statistics = PointStatistics();
+		if (!sourceSignature(sourceFilename, header.sourceSize, header.sourceTime, header.sourceChecksum))
+			return false;
+
+		// The header is a placeholder until finish() knows the point count and bounds.
+		path = cachePath(sourceFilename);
+		out.open(path + ".tmp", std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!out.is_open())
+		{
+			std::cerr << "WARNING: Could not write cache file: " << path << ".tmp" << std::endl;
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		WritePadding(out, header.positionsOffset);
+		return out.good();
+	}
+
+	bool CloudCache::Writer::append(const glm::vec3* positions, size_t count)
+	{
+		if (!out.is_open())
+			return false;
+		if (count == 0)
+			return true;
+
+		out.write(reinterpret_cast<const char*>(positions), count * sizeof(glm::vec3));
+		statistics.merge(computeStatistics(positions, count));
+		header.pointCount += count;
+		return out.good();
+	}
+
+	bool CloudCache::Writer::finish()
+	{
+		if (!out.is_open())
+			return false;
+
+		const glm::vec3 lo = statistics.min(), hi = statistics.max();
+		for (int i = 0; i < 3; ++i)
+		{
+			header.boundsMin[i] = lo[i];
+			header.boundsMax[i] = hi[i];
+		}
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		const bool written = out.good();
+		out.close();
+
+		const std::string temporaryPath = path + ".tmp";
+		if (!written)
+		{
+			std::remove(temporaryPath.c_str());
+			std::cerr << "WARNING: Could not write cache file: " << temporaryPath << std::endl;
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void CloudCache::Writer::abandon()
+	{
+		if (!out.is_open())
+			return;
+		out.close();
+		std::remove((path + ".tmp").c_str());
+	}
+
+	bool CloudCache::open(const std::string& sourceFilename)
+	{
+		close();
+
+		const std::string path = cachePath(sourceFilename);
+		std::error_code error;
+		if (!std::filesystem::exists(path, error))
+			return false;
+
+		uint64_t sourceSize = 0, sourceChecksum = 0;
+		int64_t sourceTime = 0;
+		if (!sourceSignature(sourceFilename, sourceSize, sourceTime, sourceChecksum))
+			return false;
+
+		std::unique_ptr<MappedFile> mapped(new MappedFile(path));
+		if (!mapped->isOpen() || mapped->size() < sizeof(Header))
+			return false;
+
+		const Header* candidate = reinterpret_cast<const Header*>(mapped->data());
+		if (std::memcmp(candidate->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || candidate->version != CACHE_VERSION)
+			return false;
+		if (candidate->sourceSize != sourceSize || candidate->sourceTime != sourceTime || candidate->sourceChecksum != sourceChecksum)
+		{
+			std::cout << "Cache " << path << " is stale, parsing the source again." << std::endl;
+			return false;
+		}
+
+		// Every referenced range has to lie inside the mapping.
+		const FieldEntry* entries = reinterpret_cast<const FieldEntry*>(mapped->data() + sizeof(Header));
+		if (sizeof(Header) + candidate->fieldCount * sizeof(FieldEntry) > mapped->size() ||
+			candidate->positionsOffset + candidate->pointCount * sizeof(glm::vec3) > mapped->size())
+			return false;
+		for (uint32_t i = 0; i < candidate->fieldCount; ++i)
+		{
+			if (entries[i].offset + candidate->pointCount * entries[i].size * entries[i].count > mapped->size())
+				return false;
+		}
+
+		file = std::move(mapped);
+		header = candidate;
+		return true;
+	}
+
+	void CloudCache::close()
+	{
+		header = nullptr;
+		file.reset();
+	}
+
+	const glm::vec3* CloudCache::positions() const
+	{
+		if (!header)
+			return nullptr;
+		return reinterpret_cast<const glm::vec3*>(file->data() + header->positionsOffset);
+	}
+}
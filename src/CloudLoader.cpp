@@ -0,0 +1,344 @@
+#include "CloudLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include "CloudCache.h"
+#include "CsvLoader.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MortonOrder.h"
+#include "PCDparser.h"
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		const size_t HANDOFF_POINTS = 1u << 20;
+
+		// Batches waiting for the render thread before the loader stalls.
+		const size_t READY_BATCHES = 8;
+
+		// CSV text per parse job, and parse jobs in flight per thread.
+		const size_t CHUNK_BYTES = 4u << 20;
+		const size_t CHUNKS_PER_THREAD = 2;
+
+		struct ParsedChunk
+		{
+			size_t sequence = 0;
+			size_t bytes = 0;
+			std::vector<glm::vec3> points;
+		};
+
+		bool IsFinite(const glm::vec3& point)
+		{
+			return std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z);
+		}
+
+		void Backoff(unsigned int& spins)
+		{
+			if (++spins < 64)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	CloudLoader::CloudLoader() : ready(READY_BATCHES)
+	{}
+
+	CloudLoader::~CloudLoader()
+	{
+		cancel();
+	}
+
+	void CloudLoader::start(const std::string& filename, const LoadOptions& options_)
+	{
+		cancel();
+		options = options_;
+
+		Batch stale;
+		while (ready.tryPop(stale))
+			;
+		cancelled = false;
+		progressValue = 0.0f;
+		running = true;
+		worker = std::thread(&CloudLoader::Run, this, filename);
+	}
+
+	void CloudLoader::cancel()
+	{
+		cancelled = true;
+		if (worker.joinable())
+			worker.join();
+		running = false;
+	}
+
+	size_t CloudLoader::takeBatches(std::vector<Batch>& batches)
+	{
+		size_t count = 0;
+		Batch batch;
+		while (ready.tryPop(batch))
+		{
+			batches.push_back(std::move(batch));
+			++count;
+		}
+		return count;
+	}
+
+	bool CloudLoader::Push(Batch&& batch)
+	{
+		unsigned int spins = 0;
+		while (!ready.tryPush(std::move(batch)))
+		{
+			if (cancelled)
+				return false;
+			Backoff(spins);
+		}
+		return true;
+	}
+
+	bool CloudLoader::PushPoints(const glm::vec3* points, size_t count, float progressBegin, float progressEnd)
+	{
+		for (size_t first = 0; first < count; first += HANDOFF_POINTS)
+		{
+			if (cancelled)
+				return false;
+
+			size_t last = std::min(count, first + HANDOFF_POINTS);
+			Batch batch;
+			batch.points.reserve(last - first);
+			std::copy_if(points + first, points + last, std::back_inserter(batch.points), IsFinite);
+			if (!Push(std::move(batch)))
+				return false;
+			progressValue = progressBegin + (progressEnd - progressBegin) * static_cast<float>(last) / static_cast<float>(count);
+		}
+		return !cancelled;
+	}
+
+	bool CloudLoader::FilterPoints(const glm::vec3* points, size_t count, float progressBegin, float progressEnd)
+	{
+		std::vector<glm::vec3> filtered;
+		bool changed = false;
+
+		if (options.voxelSize > 0 && !cancelled)
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (voxelDownsample(points, count, options.voxelSize, options.voxelMode, filtered))
+			{
+				std::cout << "Downsampled " << count << " points to " << filtered.size() << " in "
+					<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms." << std::endl;
+				points = filtered.data();
+				count = filtered.size();
+				changed = true;
+			}
+		}
+
+		if (options.outlierSigma > 0 && !cancelled)
+		{
+			auto start = std::chrono::steady_clock::now();
+			std::vector<glm::vec3> inliers;
+			if (removeOutliers(points, count, options.outlierNeighbours, options.outlierSigma, inliers))
+			{
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				std::cout << "Removed " << count - inliers.size() << " outliers from " << count << " points in " << seconds * 1000.0 << " ms ("
+					<< (seconds > 0 ? count / seconds : 0.0) << " points/s)." << std::endl;
+				filtered.swap(inliers);
+				changed = true;
+			}
+		}
+
+		if (!changed)
+			return false;
+		PushPoints(filtered.data(), filtered.size(), progressBegin, progressEnd);
+		return true;
+	}
+
+	bool CloudLoader::StreamCsv(const std::string& filename, std::vector<glm::vec3>* allPoints, CloudCache::Writer* cache, bool handOff)
+	{
+		CsvLoader csvLoader(filename);
+		if (!csvLoader.isOpen())
+			return false;
+		MappedFile file(filename);
+		if (!file.isOpen())
+			return false;
+
+		const char* data = file.data();
+		const size_t size = file.size();
+		const size_t depth = std::max<size_t>(2, workerCount() * CHUNKS_PER_THREAD);
+
+		// Parse jobs never wait for room: at most 'depth' chunks are between the read and reorder stages. A push
+		// that fails anyway would lose a chunk the reorder stage waits for, so it fails the load instead.
+		BoundedQueue<ParsedChunk> parsed(depth);
+		std::atomic<bool> overflowed{ false };
+		std::deque<JobSystem::Handle> jobs;
+		std::map<size_t, ParsedChunk> reorder;
+		size_t offset = std::min(csvLoader.dataBegin(), size), consumed = offset;
+		size_t readSequence = 0, emitSequence = 0;
+
+		unsigned int spins = 0;
+		while (!cancelled && !overflowed && (offset < size || emitSequence < readSequence))
+		{
+			bool busy = false;
+
+			// Read: cut the next chunk at a line boundary, fault its pages in and queue it for parsing.
+			if (offset < size && readSequence - emitSequence < depth)
+			{
+				size_t chunkEnd = std::min(size, offset + CHUNK_BYTES);
+				const char* newline = chunkEnd < size ? static_cast<const char*>(std::memchr(data + chunkEnd, '\n', size - chunkEnd)) : nullptr;
+				chunkEnd = newline ? newline - data + 1 : size;
+				file.prefetch(offset, chunkEnd - offset);
+
+				const char* begin = data + offset;
+				const char* end = data + chunkEnd;
+				const size_t sequence = readSequence++;
+				jobs.push_back(JobSystem::current().submit([&csvLoader, &parsed, &overflowed, begin, end, sequence]
+				{
+					ParsedChunk chunk;
+					chunk.sequence = sequence;
+					chunk.bytes = end - begin;
+					csvLoader.parseRows(begin, end, chunk.points);
+					chunk.points.erase(std::remove_if(chunk.points.begin(), chunk.points.end(),
+						[](const glm::vec3& point) { return !IsFinite(point); }), chunk.points.end());
+					if (!parsed.tryPush(std::move(chunk)))
+						overflowed = true;
+				}));
+				offset = chunkEnd;
+				busy = true;
+			}
+
+			// Reorder: chunks finish in any order, but are handed to the render thread in file order.
+			ParsedChunk chunk;
+			while (parsed.tryPop(chunk))
+				reorder[chunk.sequence] = std::move(chunk);
+			for (auto next = reorder.find(emitSequence); next != reorder.end() && !cancelled; next = reorder.find(emitSequence))
+			{
+				Batch batch;
+				batch.points = std::move(next->second.points);
+				consumed += next->second.bytes;
+				reorder.erase(next);
+				++emitSequence;
+				busy = true;
+
+				if (allPoints)
+					allPoints->insert(allPoints->end(), batch.points.begin(), batch.points.end());
+				if (cache)
+					cache->append(batch.points.data(), batch.points.size());
+				progressValue = static_cast<float>(consumed) / static_cast<float>(size) * (handOff ? 1.0f : 0.5f);
+				if (handOff && !batch.points.empty())
+					Push(std::move(batch));
+			}
+
+			while (!jobs.empty() && JobSystem::isDone(jobs.front()))
+				jobs.pop_front();
+
+			// Nothing to read or hand over: help parse until the oldest chunk is done.
+			if (busy)
+				spins = 0;
+			else if (!jobs.empty())
+				JobSystem::current().wait(jobs.front());
+			else
+				Backoff(spins);
+		}
+
+		// The jobs still running read the mapping and write the queue, so both have to outlive them.
+		for (const JobSystem::Handle& job : jobs)
+			JobSystem::current().wait(job);
+		if (overflowed)
+		{
+			std::cerr << "ERROR! CSV parse queue overflowed, stopped loading " << filename << "." << std::endl;
+			return false;
+		}
+		return !cancelled;
+	}
+
+	void CloudLoader::Run(std::string filename)
+	{
+		std::string extension = filename.substr(std::min(filename.rfind("."), filename.size()));
+		bool cacheable = options.useCache && (extension == ".pcd" || extension == ".csv");
+		const bool filtering = options.voxelSize > 0 || options.outlierSigma > 0;
+
+		CloudCache cache;
+		auto start = std::chrono::steady_clock::now();
+		if (cacheable && cache.open(filename))
+		{
+			std::cout << "Loading " << cache.size() << " points from " << CloudCache::cachePath(filename) << "." << std::endl;
+
+			// Caches written by a sorted load are already in order and are read straight from the mapping. Sorting
+			// comes before filtering, which keeps the order it is given, as for a fresh parse.
+			const glm::vec3* points = cache.positions();
+			std::vector<glm::vec3> sorted;
+			std::vector<size_t> order;
+			if (options.spatialSort && mortonOrder(points, cache.size(), order))
+			{
+				sorted.assign(points, points + cache.size());
+				applyOrder(order, sorted);
+				points = sorted.data();
+			}
+			if (!FilterPoints(points, cache.size(), 0.0f, 1.0f))
+				PushPoints(points, cache.size(), 0.0f, 1.0f);
+		}
+
+		else if (extension == ".pcd")
+		{
+			PCDparser::PCDparser pcdParser(filename);
+			if (options.spatialSort)
+				sortMorton(pcdParser.points);
+
+			// Write the cache on the job system while the points are handed to the renderer. A file that failed to
+			// parse or a cancelled load is not cached, so the next run parses it again.
+			JobSystem::Handle cacheWrite;
+			if (cacheable && !cancelled && !pcdParser.points.empty())
+				cacheWrite = JobSystem::current().submit([&] { CloudCache::write(filename, pcdParser.points); });
+			if (!FilterPoints(pcdParser.points.data(), pcdParser.points.size(), 0.5f, 1.0f))
+				PushPoints(pcdParser.points.data(), pcdParser.points.size(), 0.5f, 1.0f);
+			JobSystem::current().wait(cacheWrite);
+		}
+
+		else if (extension == ".csv") // Stream ascii CSV text data so the first rows show up immediately.
+		{
+			if (options.spatialSort || filtering)
+			{
+				// Sorting and filtering need every point, so they are handed over once the whole file is parsed.
+				std::vector<glm::vec3> all;
+				if (StreamCsv(filename, &all, nullptr, false))
+				{
+					if (options.spatialSort)
+						sortMorton(all);
+					if (cacheable && !cancelled && !all.empty())
+						CloudCache::write(filename, all);
+					if (!FilterPoints(all.data(), all.size(), 0.5f, 1.0f))
+						PushPoints(all.data(), all.size(), 0.5f, 1.0f);
+				}
+			}
+			else
+			{
+				// Batches are written to the cache as they are handed over, so the whole file is never held in memory.
+				CloudCache::Writer cacheWriter;
+				const bool caching = cacheable && cacheWriter.begin(filename);
+				if (StreamCsv(filename, nullptr, caching ? &cacheWriter : nullptr) && caching && cacheWriter.size() > 0)
+					cacheWriter.finish();
+			}
+		}
+
+		else // Default behavior, handle greyscale image files (to be read using OpenCV's codecs)
+		{
+			Batch batch;
+			batch.image = cv::imread(filename, cv::IMREAD_GRAYSCALE);
+			if (!batch.image.empty())
+				Push(std::move(batch));
+		}
+
+		if (!cancelled)
+		{
+			progressValue = 1.0f;
+			std::cout << "Finished loading " << filename << " in "
+				<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms." << std::endl;
+		}
+		running = false;
+	}
+}
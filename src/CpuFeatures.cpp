@@ -0,0 +1,106 @@
+#include "CpuFeatures.h"
+#include <atomic>
+#include <iostream>
+
+#if defined(CPUFEATURES_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		SimdLevel Detect()
+		{
+#ifdef CPUFEATURES_X86
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			const int leaves = info[0];
+			__cpuid(info, 1);
+			const bool sse2 = (info[3] & (1 << 26)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			if (!sse2)
+				return SimdLevel::Scalar;
+			if (leaves < 7 || !osxsave)
+				return SimdLevel::Sse2;
+
+			// The OS has to save the YMM (and for AVX-512 the opmask and ZMM) registers on context switches.
+			__cpuidex(info, 7, 0);
+			const unsigned long long xcr0 = _xgetbv(0);
+			const bool avx2 = (info[1] & (1 << 5)) != 0 && (info[1] & (1 << 3)) != 0 && (xcr0 & 0x6) == 0x6;
+			const bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+#else
+			__builtin_cpu_init();
+			const bool sse2 = __builtin_cpu_supports("sse2");
+			const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+			const bool avx512 = __builtin_cpu_supports("avx512f");
+			if (!sse2)
+				return SimdLevel::Scalar;
+#endif
+			if (avx2 && avx512)
+				return SimdLevel::Avx512;
+			if (avx2)
+				return SimdLevel::Avx2;
+			return SimdLevel::Sse2;
+#else
+			return SimdLevel::Scalar;
+#endif
+		}
+
+		// -1 while no tier is forced.
+		std::atomic<int> forcedLevel(-1);
+	}
+
+	SimdLevel detectedSimdLevel()
+	{
+		static const SimdLevel detected = Detect();
+		return detected;
+	}
+
+	SimdLevel simdLevel()
+	{
+		int forced = forcedLevel.load(std::memory_order_relaxed);
+		return forced < 0 ? detectedSimdLevel() : static_cast<SimdLevel>(forced);
+	}
+
+	void setSimdLevel(SimdLevel level)
+	{
+		if (level > detectedSimdLevel())
+		{
+			std::cerr << "WARNING: This CPU does not support " << simdLevelName(level) << ", using "
+				<< simdLevelName(detectedSimdLevel()) << " instead." << std::endl;
+			level = detectedSimdLevel();
+		}
+		forcedLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+	}
+
+	bool parseSimdLevel(const std::string& name, SimdLevel& level)
+	{
+		const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2, SimdLevel::Avx512 };
+		for (SimdLevel candidate : levels)
+		{
+			if (name == simdLevelName(candidate))
+			{
+				level = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const char* simdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::Avx512:
+			return "avx512";
+		case SimdLevel::Avx2:
+			return "avx2";
+		case SimdLevel::Sse2:
+			return "sse2";
+		default:
+			return "scalar";
+		}
+	}
+}
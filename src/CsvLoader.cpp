@@ -0,0 +1,242 @@
+#include "CsvLoader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include "AsciiParser.h"
+#include "MappedFile.h"
+#include "StringUtils.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		const size_t WINDOW_BYTES = 4u << 20;
+	}
+
+	CsvLoader::CsvLoader(const std::string& filename_) : CsvLoader(filename_, Options())
+	{}
+
+	CsvLoader::CsvLoader(const std::string& filename_, const Options& options_) :
+		filename(filename_), options(options_)
+	{
+		stream.open(filename, std::ios::binary | std::ios::in);
+		if (!stream.is_open())
+		{
+			std::cerr << "ERROR! Could not open file: " << filename << std::endl;
+			return;
+		}
+
+		stream.seekg(0, std::ios::end);
+		fileSize = static_cast<size_t>(stream.tellg());
+		stream.seekg(0, std::ios::beg);
+
+		// The header and skipped rows have to fit into the first window.
+		window.resize(WINDOW_BYTES);
+		RefillWindow();
+		if (!ScanHeader(window.data(), window.data() + windowEnd))
+		{
+			stream.close();
+			return;
+		}
+
+		windowBegin = dataOffset;
+	}
+
+	bool CsvLoader::ScanHeader(const char* begin, const char* end)
+	{
+		const char* cursor = begin;
+		auto nextLine = [&](const char* from) {
+			const char* newline = static_cast<const char*>(std::memchr(from, '\n', end - from));
+			return newline ? newline + 1 : end;
+		};
+
+		for (size_t i = 0; i < options.skipRows && cursor < end; ++i)
+			cursor = nextLine(cursor);
+
+		if (options.detectHeader)
+		{
+			while (cursor < end && !AsciiChunkParser::isDataRow(cursor, nextLine(cursor), options.delimiter))
+				cursor = nextLine(cursor);
+
+			const char* first = cursor;
+			while (first < end && (*first == ' ' || *first == '\t' || *first == options.delimiter))
+				++first;
+			if (first < end && !std::isdigit(static_cast<unsigned char>(*first)) && *first != '-' && *first != '+' && *first != '.')
+			{
+				const char* lineEnd = nextLine(cursor);
+				names = tokenize(std::string(cursor, lineEnd), std::string(1, options.delimiter) + " \t\r\n");
+				cursor = lineEnd;
+			}
+		}
+		dataOffset = cursor - begin;
+
+		if (options.columns.size() < 3)
+		{
+			std::cerr << "ERROR! CSV column mapping needs at least x, y and z." << std::endl;
+			return false;
+		}
+
+		columnIndices.clear();
+		valuesPerRow = 0;
+		for (const Column& column : options.columns)
+		{
+			int index = column.index;
+			if (index < 0)
+			{
+				auto found = std::find(names.begin(), names.end(), column.name);
+				if (found == names.end())
+				{
+					std::cerr << "ERROR! CSV file has no column named '" << column.name << "'." << std::endl;
+					return false;
+				}
+				index = static_cast<int>(found - names.begin());
+			}
+			columnIndices.push_back(index);
+			valuesPerRow = std::max(valuesPerRow, static_cast<size_t>(index) + 1);
+		}
+		rowValues.resize(valuesPerRow);
+
+		return true;
+	}
+
+	bool CsvLoader::load(std::vector<glm::vec3>& positions)
+	{
+		if (columnIndices.empty())
+			return false;
+
+		MappedFile file(filename);
+		if (!file.isOpen())
+			return false;
+
+		AsciiChunkParser parser(file.data() + dataOffset, file.data() + file.size(), options.delimiter, valuesPerRow);
+		positions.resize(parser.rows());
+		const int x = columnIndices[0], y = columnIndices[1], z = columnIndices[2];
+		parser.parse([&](size_t row, const double* values)
+		{
+			positions[row] = glm::vec3(static_cast<float>(values[x]), static_cast<float>(values[y]), static_cast<float>(values[z]));
+		});
+
+		return true;
+	}
+
+	bool CsvLoader::load(PointColumns& columns)
+	{
+		if (columnIndices.empty())
+			return false;
+
+		MappedFile file(filename);
+		if (!file.isOpen())
+			return false;
+
+		std::vector<FieldSchema> schema(options.columns.size());
+		for (size_t i = 0; i < schema.size(); ++i)
+			schema[i].name = options.columns[i].name;
+
+		AsciiChunkParser parser(file.data() + dataOffset, file.data() + file.size(), options.delimiter, valuesPerRow);
+		columns.allocate(schema, parser.rows());
+		parser.parse([&](size_t row, const double* values)
+		{
+			for (int f = 0; f < static_cast<int>(columnIndices.size()); ++f)
+				columns.data<float>(f)[row] = static_cast<float>(values[columnIndices[f]]);
+		});
+
+		return true;
+	}
+
+	bool CsvLoader::nextBatch(std::vector<glm::vec3>& batch, size_t batchSize)
+	{
+		batch.clear();
+		if (columnIndices.empty())
+			return false;
+
+		const int x = columnIndices[0], y = columnIndices[1], z = columnIndices[2];
+		while (batch.size() < batchSize)
+		{
+			const char* begin = window.data() + windowBegin;
+			const char* end = window.data() + windowEnd;
+			const char* lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+
+			// No complete line left: slide the window, and at the end of the file take the unterminated tail.
+			if (lineEnd == nullptr && RefillWindow())
+				continue;
+			if (lineEnd == nullptr && begin == end)
+				break;
+			if (lineEnd == nullptr)
+				lineEnd = end;
+
+			if (AsciiChunkParser::isDataRow(begin, lineEnd, options.delimiter))
+			{
+				size_t found = AsciiChunkParser::parseLine(begin, lineEnd, options.delimiter, rowValues.data(), valuesPerRow);
+				std::fill(rowValues.begin() + found, rowValues.end(), 0.0);
+				batch.push_back(glm::vec3(static_cast<float>(rowValues[x]), static_cast<float>(rowValues[y]), static_cast<float>(rowValues[z])));
+			}
+			windowBegin = std::min<size_t>(lineEnd - window.data() + 1, windowEnd);
+		}
+
+		return batch.size() > 0;
+	}
+
+	void CsvLoader::parseRows(const char* begin, const char* end, std::vector<glm::vec3>& points) const
+	{
+		if (columnIndices.empty())
+			return;
+
+		const int x = columnIndices[0], y = columnIndices[1], z = columnIndices[2];
+		std::vector<double> values(valuesPerRow);
+		while (begin < end)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+			if (lineEnd == nullptr)
+				lineEnd = end;
+
+			if (AsciiChunkParser::isDataRow(begin, lineEnd, options.delimiter))
+			{
+				size_t found = AsciiChunkParser::parseLine(begin, lineEnd, options.delimiter, values.data(), valuesPerRow);
+				std::fill(values.begin() + found, values.end(), 0.0);
+				points.push_back(glm::vec3(static_cast<float>(values[x]), static_cast<float>(values[y]), static_cast<float>(values[z])));
+			}
+			begin = lineEnd + 1;
+		}
+	}
+
+	bool CsvLoader::RefillWindow()
+	{
+		if (!stream.is_open() || stream.eof())
+			return false;
+
+		// Keep the unconsumed tail and grow only if a single line is longer than the window.
+		size_t remaining = windowEnd - windowBegin;
+		if (remaining > 0 && windowBegin > 0)
+			std::memmove(window.data(), window.data() + windowBegin, remaining);
+		windowBegin = 0;
+		windowEnd = remaining;
+		if (windowEnd == window.size())
+			window.resize(window.size() * 2);
+
+		stream.read(window.data() + windowEnd, window.size() - windowEnd);
+		size_t read = static_cast<size_t>(stream.gcount());
+		windowEnd += read;
+		consumed += read;
+		return read > 0;
+	}
+
+	float CsvLoader::progress() const
+	{
+		if (fileSize == 0)
+			return 1.0f;
+		return static_cast<float>(consumed - (windowEnd - windowBegin)) / static_cast<float>(fileSize);
+	}
+
+	void CsvLoader::rewind()
+	{
+		if (!stream.is_open())
+			return;
+
+		stream.clear();
+		stream.seekg(0, std::ios::beg);
+		windowBegin = windowEnd = consumed = 0;
+		RefillWindow();
+		windowBegin = std::min(dataOffset, windowEnd);
+	}
+}
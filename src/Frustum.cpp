@@ -0,0 +1,178 @@
+#include "Frustum.h"
+#include "CpuFeatures.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// For each plane, the coordinate arrays of the box corner furthest along its normal, and the plane itself.
+		// A box is outside a plane exactly if that corner is.
+		struct CullInput
+		{
+			const float* corner[6][3];
+			float plane[6][4];
+		};
+
+		void CullScalar(const CullInput& in, size_t first, size_t count, unsigned char* visible)
+		{
+			for (size_t i = first; i < count; ++i)
+			{
+				bool inside = true;
+				for (int p = 0; p < 6; ++p)
+				{
+					const float distance = in.plane[p][0] * in.corner[p][0][i] + in.plane[p][1] * in.corner[p][1][i] + in.plane[p][2] * in.corner[p][2][i] + in.plane[p][3];
+					inside &= distance >= 0;
+				}
+				visible[i] = inside ? 1 : 0;
+			}
+		}
+
+#ifdef CPUFEATURES_X86
+		// Each kernel tests whole registers of boxes and returns how many boxes it tested.
+		typedef size_t (*CullBlocks)(const CullInput& in, size_t count, unsigned char* visible);
+
+		size_t CullSse2(const CullInput& in, size_t count, unsigned char* visible)
+		{
+			const size_t W = 4, blocks = count / W;
+			const __m128 zero = _mm_setzero_ps();
+			for (size_t b = 0, i = 0; b < blocks; ++b, i += W)
+			{
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int p = 0; p < 6; ++p)
+				{
+					__m128 distance = _mm_mul_ps(_mm_set1_ps(in.plane[p][0]), _mm_loadu_ps(in.corner[p][0] + i));
+					distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(in.plane[p][1]), _mm_loadu_ps(in.corner[p][1] + i)));
+					distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(in.plane[p][2]), _mm_loadu_ps(in.corner[p][2] + i)));
+					distance = _mm_add_ps(distance, _mm_set1_ps(in.plane[p][3]));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+				}
+				const int mask = _mm_movemask_ps(inside);
+				for (size_t k = 0; k < W; ++k)
+					visible[i + k] = (mask >> k) & 1;
+			}
+			return blocks * W;
+		}
+
+		CPUFEATURES_TARGET_AVX2 size_t CullAvx2(const CullInput& in, size_t count, unsigned char* visible)
+		{
+			const size_t W = 8, blocks = count / W;
+			const __m256 zero = _mm256_setzero_ps();
+			for (size_t b = 0, i = 0; b < blocks; ++b, i += W)
+			{
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (int p = 0; p < 6; ++p)
+				{
+					__m256 distance = _mm256_mul_ps(_mm256_set1_ps(in.plane[p][0]), _mm256_loadu_ps(in.corner[p][0] + i));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(in.plane[p][1]), _mm256_loadu_ps(in.corner[p][1] + i)));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(in.plane[p][2]), _mm256_loadu_ps(in.corner[p][2] + i)));
+					distance = _mm256_add_ps(distance, _mm256_set1_ps(in.plane[p][3]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+				}
+				const int mask = _mm256_movemask_ps(inside);
+				for (size_t k = 0; k < W; ++k)
+					visible[i + k] = (mask >> k) & 1;
+			}
+			return blocks * W;
+		}
+
+		CPUFEATURES_TARGET_AVX512 size_t CullAvx512(const CullInput& in, size_t count, unsigned char* visible)
+		{
+			const size_t W = 16, blocks = count / W;
+			const __m512 zero = _mm512_setzero_ps();
+			for (size_t b = 0, i = 0; b < blocks; ++b, i += W)
+			{
+				__mmask16 inside = 0xFFFF;
+				for (int p = 0; p < 6; ++p)
+				{
+					__m512 distance = _mm512_mul_ps(_mm512_set1_ps(in.plane[p][0]), _mm512_loadu_ps(in.corner[p][0] + i));
+					distance = _mm512_add_ps(distance, _mm512_mul_ps(_mm512_set1_ps(in.plane[p][1]), _mm512_loadu_ps(in.corner[p][1] + i)));
+					distance = _mm512_add_ps(distance, _mm512_mul_ps(_mm512_set1_ps(in.plane[p][2]), _mm512_loadu_ps(in.corner[p][2] + i)));
+					distance = _mm512_add_ps(distance, _mm512_set1_ps(in.plane[p][3]));
+					inside = _mm512_mask_cmp_ps_mask(inside, distance, zero, _CMP_GE_OQ);
+				}
+				for (size_t k = 0; k < W; ++k)
+					visible[i + k] = (inside >> k) & 1;
+			}
+			return blocks * W;
+		}
+#endif
+	}
+
+	void BoxList::resize(size_t count)
+	{
+		minX.resize(count);
+		minY.resize(count);
+		minZ.resize(count);
+		maxX.resize(count);
+		maxY.resize(count);
+		maxZ.resize(count);
+	}
+
+	void BoxList::set(size_t index, const glm::vec3& min, const glm::vec3& max)
+	{
+		minX[index] = min.x;
+		minY[index] = min.y;
+		minZ[index] = min.z;
+		maxX[index] = max.x;
+		maxY[index] = max.y;
+		maxZ[index] = max.z;
+	}
+
+	Frustum::Frustum()
+	{
+		for (int i = 0; i < 6; ++i)
+			planes[i] = glm::vec4(0, 0, 0, 1);
+	}
+
+	Frustum::Frustum(const glm::mat4& clip)
+	{
+		// Each plane is the fourth row of 'clip' plus or minus one of the others.
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				planes[2 * i][j] = clip[j][3] + clip[j][i];
+				planes[2 * i + 1][j] = clip[j][3] - clip[j][i];
+			}
+		}
+	}
+
+	bool Frustum::intersects(const glm::vec3& min, const glm::vec3& max) const
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& plane = planes[i];
+			const float distance = plane.x * (plane.x >= 0 ? max.x : min.x) + plane.y * (plane.y >= 0 ? max.y : min.y) +
+				plane.z * (plane.z >= 0 ? max.z : min.z) + plane.w;
+			if (!(distance >= 0))
+				return false;
+		}
+		return true;
+	}
+
+	void Frustum::cull(const BoxList& boxes, size_t begin, size_t end, unsigned char* visible) const
+	{
+		if (end <= begin)
+			return;
+
+		CullInput in;
+		const float* minimum[3] = { boxes.minX.data() + begin, boxes.minY.data() + begin, boxes.minZ.data() + begin };
+		const float* maximum[3] = { boxes.maxX.data() + begin, boxes.maxY.data() + begin, boxes.maxZ.data() + begin };
+		for (int p = 0; p < 6; ++p)
+		{
+			for (int c = 0; c < 3; ++c)
+				in.corner[p][c] = planes[p][c] >= 0 ? maximum[c] : minimum[c];
+			for (int c = 0; c < 4; ++c)
+				in.plane[p][c] = planes[p][c];
+		}
+
+		const size_t count = end - begin;
+		size_t done = 0;
+#ifdef CPUFEATURES_X86
+		CullBlocks cullBlocks = selectKernel<CullBlocks>(nullptr, CullSse2, CullAvx2, CullAvx512);
+		if (cullBlocks)
+			done = cullBlocks(in, count, visible);
+#endif
+		CullScalar(in, done, count, visible);
+	}
+}
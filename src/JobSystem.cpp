@@ -0,0 +1,296 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <exception>
+
+namespace PointcloudVisualizer
+{
+	class JobSystem::Job
+	{
+	public:
+		std::function<void()> work;
+
+		// Unfinished dependencies, plus one held by submit() until every dependency is registered.
+		std::atomic<int> pending{ 1 };
+		std::atomic<bool> done{ false };
+
+		// What the work threw, or what a dependency failed with, in which case the work is skipped.
+		std::exception_ptr error;
+
+		std::mutex mutex;
+		bool finished = false;
+		std::vector<Handle> dependents;
+	};
+
+	namespace
+	{
+		// Ranges parallelFor creates per thread, so a thread that finishes early can steal work.
+		const size_t RANGES_PER_THREAD = 4;
+
+		std::atomic<JobSystem*> installed(nullptr);
+
+		// The pool and deque index of the calling thread if it is a worker.
+		thread_local JobSystem* workerOwner = nullptr;
+		thread_local int workerIndex = -1;
+	}
+
+	JobSystem::JobSystem(unsigned int threads_) :
+		threads(threads_ > 0 ? threads_ : std::max(1u, std::thread::hardware_concurrency()))
+	{
+		// The thread that waits on a job helps run it, so one worker fewer than threads keeps every core busy.
+		const unsigned int workerThreads = std::max(1u, threads - 1);
+		for (unsigned int i = 0; i <= workerThreads; ++i)
+			queues.emplace_back(new Queue());
+		for (unsigned int i = 0; i < workerThreads; ++i)
+			workers.emplace_back(&JobSystem::WorkerLoop, this, static_cast<int>(i));
+	}
+
+	JobSystem::~JobSystem()
+	{
+		JobSystem* self = this;
+		installed.compare_exchange_strong(self, nullptr);
+
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	JobSystem::Handle JobSystem::submit(std::function<void()> work, const std::vector<Handle>& dependencies)
+	{
+		Handle job = std::make_shared<Job>();
+		job->work = std::move(work);
+
+		for (const Handle& dependency : dependencies)
+		{
+			if (!dependency)
+				continue;
+			std::lock_guard<std::mutex> lock(dependency->mutex);
+			if (!dependency->finished)
+			{
+				job->pending.fetch_add(1);
+				dependency->dependents.push_back(job);
+			}
+		}
+
+		if (job->pending.fetch_sub(1) == 1)
+			Enqueue(job);
+		return job;
+	}
+
+	bool JobSystem::isDone(const Handle& job)
+	{
+		return !job || job->done.load(std::memory_order_acquire);
+	}
+
+	void JobSystem::wait(const Handle& job)
+	{
+		const int self = workerOwner == this ? workerIndex : -1;
+		while (!isDone(job))
+		{
+			if (RunOne(self))
+				continue;
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			++waiting;
+			finished.wait(lock, [&] { return isDone(job) || queued.load() > 0; });
+			--waiting;
+		}
+		if (job && job->error)
+			std::rethrow_exception(job->error);
+	}
+
+	void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body)
+	{
+		if (end <= begin)
+			return;
+
+		grain = std::max<size_t>(grain, 1);
+		const size_t count = end - begin;
+		const size_t ranges = std::min<size_t>(static_cast<size_t>(threads) * RANGES_PER_THREAD, (count + grain - 1) / grain);
+		if (threads <= 1 || ranges <= 1)
+		{
+			body(begin, end);
+			return;
+		}
+
+		// Queue every range but the last, which the caller runs itself before helping with the rest.
+		std::vector<Handle> jobs;
+		std::exception_ptr error;
+		jobs.reserve(ranges - 1);
+		size_t step = count / ranges, remainder = count % ranges, rangeBegin = begin;
+		for (size_t i = 0; i < ranges; ++i)
+		{
+			size_t rangeEnd = rangeBegin + step + (i < remainder ? 1 : 0);
+			if (i + 1 == ranges)
+			{
+				try
+				{
+					body(rangeBegin, rangeEnd);
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+			}
+			else
+				jobs.push_back(submit([&body, rangeBegin, rangeEnd] { body(rangeBegin, rangeEnd); }));
+			rangeBegin = rangeEnd;
+		}
+
+		// The queued ranges reference 'body', so all of them have to finish before the first error is rethrown.
+		for (const Handle& job : jobs)
+		{
+			try
+			{
+				wait(job);
+			}
+			catch (...)
+			{
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void JobSystem::makeCurrent()
+	{
+		installed.store(this);
+	}
+
+	JobSystem& JobSystem::current()
+	{
+		JobSystem* system = installed.load();
+		if (system)
+			return *system;
+
+		static JobSystem fallback;
+		return fallback;
+	}
+
+	void JobSystem::Enqueue(const Handle& job)
+	{
+		// Workers keep their own jobs local; everyone else goes through the shared queue.
+		// Count the job before it becomes visible, so a thief can never take the count below zero.
+		Queue& queue = workerOwner == this ? *queues[workerIndex] : *queues.back();
+		queued.fetch_add(1);
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+		NotifyWaiters();
+	}
+
+	bool JobSystem::RunOne(int self)
+	{
+		Handle job;
+		if (self >= 0)
+		{
+			Queue& own = *queues[self];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.jobs.empty())
+			{
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+			}
+		}
+
+		// Then the shared queue, then steal the oldest job of another worker.
+		const int count = static_cast<int>(queues.size());
+		for (int k = 0; !job && k < count; ++k)
+		{
+			const int victim = (count - 1 + k) % count;
+			if (victim == self)
+				continue;
+			Queue& queue = *queues[victim];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+			}
+		}
+
+		if (!job)
+			return false;
+
+		queued.fetch_sub(1);
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::Execute(const Handle& job)
+	{
+		// A job that throws still finishes and releases its dependents, so nothing waits for it forever.
+		if (!job->error)
+		{
+			try
+			{
+				job->work();
+			}
+			catch (...)
+			{
+				job->error = std::current_exception();
+			}
+		}
+		job->work = nullptr;
+
+		std::vector<Handle> dependents;
+		{
+			std::lock_guard<std::mutex> lock(job->mutex);
+			job->finished = true;
+			dependents.swap(job->dependents);
+		}
+		job->done.store(true, std::memory_order_release);
+
+		for (const Handle& dependent : dependents)
+		{
+			if (job->error)
+			{
+				std::lock_guard<std::mutex> lock(dependent->mutex);
+				if (!dependent->error)
+					dependent->error = job->error;
+			}
+			if (dependent->pending.fetch_sub(1) == 1)
+				Enqueue(dependent);
+		}
+		NotifyWaiters();
+	}
+
+	void JobSystem::WorkerLoop(int index)
+	{
+		workerOwner = this;
+		workerIndex = index;
+
+		while (true)
+		{
+			if (RunOne(index))
+				continue;
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+			if (stopping && queued.load() == 0)
+				return;
+		}
+	}
+
+	void JobSystem::NotifyWaiters()
+	{
+		bool notify;
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			notify = waiting > 0;
+		}
+		if (notify)
+			finished.notify_all();
+	}
+}
@@ -0,0 +1,256 @@
+#include "KdTree.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Ranges at least this large build their two halves in parallel.
+		const size_t PARALLEL_POINTS = 1u << 16;
+
+		// Fewest queries a worker answers in one go.
+		const size_t QUERY_GRAIN = 1u << 10;
+
+		float SquaredDistance(const glm::vec3& a, const glm::vec3& b)
+		{
+			const glm::vec3 d = a - b;
+			return d.x * d.x + d.y * d.y + d.z * d.z;
+		}
+	}
+
+	// Max-heap of the k nearest points found so far, keyed on squared distance.
+	struct KdTree::Neighbours
+	{
+		size_t k;
+		float limit;
+		std::vector<std::pair<float, uint32_t>> heap;
+
+		Neighbours(size_t k_, float limit_) : k(k_), limit(limit_) { heap.reserve(k); }
+
+		// Squared distance a point has to be within to be kept.
+		float bound() const { return heap.size() < k ? limit : heap.front().first; }
+
+		void consider(float squaredDistance, uint32_t index)
+		{
+			if (heap.size() < k)
+			{
+				if (!(squaredDistance <= limit))
+					return;
+				heap.push_back(std::make_pair(squaredDistance, index));
+				std::push_heap(heap.begin(), heap.end());
+			}
+			else if (squaredDistance < heap.front().first)
+			{
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = std::make_pair(squaredDistance, index);
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+
+		// Writes the neighbours nearest first and returns how many there are.
+		size_t write(uint32_t* indices, float* squaredDistances)
+		{
+			std::sort_heap(heap.begin(), heap.end());
+			for (size_t i = 0; i < heap.size(); ++i)
+			{
+				indices[i] = heap[i].second;
+				squaredDistances[i] = heap[i].first;
+			}
+			return heap.size();
+		}
+	};
+
+	bool KdTree::build(const glm::vec3* points, size_t count)
+	{
+		clear();
+		if (count > NO_POINT)
+		{
+			std::cerr << "ERROR! KD-tree of " << count << " points has more than 2^32 points." << std::endl;
+			return false;
+		}
+
+		glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+		entries.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const glm::vec3& p = points[i];
+			if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+				continue;
+			Entry entry;
+			entry.point = p;
+			entry.index = static_cast<uint32_t>(i);
+			entries.push_back(entry);
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+
+		axes.assign(entries.size(), 0);
+		Build(0, entries.size(), min, max);
+		return true;
+	}
+
+	void KdTree::clear()
+	{
+		std::vector<Entry>().swap(entries);
+		std::vector<unsigned char>().swap(axes);
+	}
+
+	void KdTree::Build(size_t begin, size_t end, glm::vec3 min, glm::vec3 max)
+	{
+		if (end - begin <= LEAF_POINTS)
+			return;
+
+		// Split the widest side of the range's box at its median.
+		const glm::vec3 extent = max - min;
+		const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		const size_t middle = begin + (end - begin) / 2;
+		std::nth_element(entries.begin() + begin, entries.begin() + middle, entries.begin() + end,
+			[axis](const Entry& a, const Entry& b) { return a.point[axis] < b.point[axis]; });
+		axes[middle] = static_cast<unsigned char>(axis);
+
+		glm::vec3 leftMax = max, rightMin = min;
+		leftMax[axis] = rightMin[axis] = entries[middle].point[axis];
+		auto buildHalves = [&](size_t first, size_t last)
+		{
+			for (size_t half = first; half < last; ++half)
+			{
+				if (half == 0)
+					Build(begin, middle, min, leftMax);
+				else
+					Build(middle + 1, end, rightMin, max);
+			}
+		};
+		if (end - begin >= PARALLEL_POINTS)
+			parallelFor(0, 2, 1, buildHalves);
+		else
+			buildHalves(0, 2);
+	}
+
+	void KdTree::SearchNearest(size_t begin, size_t end, const glm::vec3& query, Neighbours& found) const
+	{
+		// Descend into the half on the query's side first; the other half can only hold a nearer point if the
+		// split plane is closer than the current k-th neighbour.
+		while (end - begin > LEAF_POINTS)
+		{
+			const size_t middle = begin + (end - begin) / 2;
+			const Entry& median = entries[middle];
+			found.consider(SquaredDistance(query, median.point), median.index);
+
+			const float offset = query[axes[middle]] - median.point[axes[middle]];
+			if (offset < 0)
+				SearchNearest(begin, middle, query, found);
+			else
+				SearchNearest(middle + 1, end, query, found);
+			if (offset * offset > found.bound())
+				return;
+			if (offset < 0)
+				begin = middle + 1;
+			else
+				end = middle;
+		}
+
+		for (size_t i = begin; i < end; ++i)
+			found.consider(SquaredDistance(query, entries[i].point), entries[i].index);
+	}
+
+	void KdTree::SearchRadius(size_t begin, size_t end, const glm::vec3& query, float squaredRadius, std::vector<uint32_t>& found) const
+	{
+		while (end - begin > LEAF_POINTS)
+		{
+			const size_t middle = begin + (end - begin) / 2;
+			const Entry& median = entries[middle];
+			if (SquaredDistance(query, median.point) <= squaredRadius)
+				found.push_back(median.index);
+
+			const float offset = query[axes[middle]] - median.point[axes[middle]];
+			const bool bothHalves = offset * offset <= squaredRadius;
+			if (offset < 0)
+			{
+				if (bothHalves)
+					SearchRadius(middle + 1, end, query, squaredRadius, found);
+				end = middle;
+			}
+			else
+			{
+				if (bothHalves)
+					SearchRadius(begin, middle, query, squaredRadius, found);
+				begin = middle + 1;
+			}
+		}
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (SquaredDistance(query, entries[i].point) <= squaredRadius)
+				found.push_back(entries[i].index);
+		}
+	}
+
+	size_t KdTree::nearest(const glm::vec3& query, size_t k, uint32_t* indices, float* squaredDistances, float maxDistance) const
+	{
+		if (k == 0 || entries.empty())
+			return 0;
+		Neighbours found(k, maxDistance * maxDistance);
+		SearchNearest(0, entries.size(), query, found);
+		return found.write(indices, squaredDistances);
+	}
+
+	void KdTree::nearest(const glm::vec3* queries, size_t count, size_t k, uint32_t* indices, float* squaredDistances) const
+	{
+		if (k == 0)
+			return;
+
+		parallelFor(0, count, QUERY_GRAIN, [&](size_t begin, size_t end)
+		{
+			Neighbours found(k, std::numeric_limits<float>::infinity());
+			for (size_t i = begin; i < end; ++i)
+			{
+				found.heap.clear();
+				if (!entries.empty())
+					SearchNearest(0, entries.size(), queries[i], found);
+				const size_t written = found.write(indices + i * k, squaredDistances + i * k);
+				std::fill(indices + i * k + written, indices + (i + 1) * k, NO_POINT);
+				std::fill(squaredDistances + i * k + written, squaredDistances + (i + 1) * k, std::numeric_limits<float>::infinity());
+			}
+		});
+	}
+
+	void KdTree::withinRadius(const glm::vec3& query, float radius, std::vector<uint32_t>& indices) const
+	{
+		if (!entries.empty())
+			SearchRadius(0, entries.size(), query, radius * radius, indices);
+	}
+
+	void KdTree::withinRadius(const glm::vec3* queries, size_t count, float radius, std::vector<size_t>& offsets,
+		std::vector<uint32_t>& indices) const
+	{
+		// Each slice of queries collects its neighbours on its own; they are then concatenated in query order.
+		const size_t slices = std::max<size_t>(1, std::min<size_t>(workerCount() * 4, count / QUERY_GRAIN));
+		std::vector<std::vector<uint32_t>> found(slices);
+		offsets.assign(count + 1, 0);
+		parallelFor(0, slices, 1, [&](size_t first, size_t last)
+		{
+			for (size_t s = first; s < last; ++s)
+			{
+				for (size_t i = count * s / slices, end = count * (s + 1) / slices; i < end; ++i)
+				{
+					const size_t before = found[s].size();
+					withinRadius(queries[i], radius, found[s]);
+					offsets[i + 1] = found[s].size() - before;
+				}
+			}
+		});
+
+		for (size_t i = 0; i < count; ++i)
+			offsets[i + 1] += offsets[i];
+		indices.resize(offsets[count]);
+		parallelFor(0, slices, 1, [&](size_t first, size_t last)
+		{
+			for (size_t s = first; s < last; ++s)
+				std::copy(found[s].begin(), found[s].end(), indices.begin() + offsets[count * s / slices]);
+		});
+	}
+}
@@ -0,0 +1,64 @@
+#include "LZF.h"
+#include <cstring>
+
+namespace PointcloudVisualizer
+{
+	size_t lzfDecompress(const void* input, size_t inputSize, void* output, size_t outputSize)
+	{
+		const unsigned char* ip = static_cast<const unsigned char*>(input);
+		const unsigned char* inEnd = ip + inputSize;
+		unsigned char* op = static_cast<unsigned char*>(output);
+		unsigned char* outStart = op;
+		unsigned char* outEnd = op + outputSize;
+
+		while (ip < inEnd)
+		{
+			size_t ctrl = *ip++;
+
+			if (ctrl < (1 << 5))
+			{
+				// Literal run of ctrl + 1 bytes.
+				ctrl++;
+				if (op + ctrl > outEnd || ip + ctrl > inEnd)
+					return 0;
+
+				std::memcpy(op, ip, ctrl);
+				op += ctrl;
+				ip += ctrl;
+			}
+			else
+			{
+				// Back reference: 3 bits of length, 13 bits of distance.
+				size_t length = ctrl >> 5;
+				if (ip >= inEnd)
+					return 0;
+				if (length == 7)
+				{
+					length += *ip++;
+					if (ip >= inEnd)
+						return 0;
+				}
+				length += 2;
+
+				size_t distance = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+				if (op + length > outEnd || distance > static_cast<size_t>(op - outStart))
+					return 0;
+
+				const unsigned char* ref = op - distance;
+				if (distance >= length)
+				{
+					std::memcpy(op, ref, length);
+					op += length;
+				}
+				else
+				{
+					// Overlapping copy repeats the last 'distance' bytes, so it has to go byte by byte.
+					for (size_t i = 0; i < length; ++i)
+						*op++ = *ref++;
+				}
+			}
+		}
+
+		return op - outStart;
+	}
+}
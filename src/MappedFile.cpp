@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PointcloudVisualizer
+{
+	MappedFile::MappedFile(const std::string& filename)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			std::cerr << "ERROR! Could not open file: " << filename << std::endl;
+			return;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return;
+		}
+
+		HANDLE mappingObject = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingObject == NULL)
+		{
+			std::cerr << "ERROR! Could not map file: " << filename << std::endl;
+			CloseHandle(file);
+			return;
+		}
+
+		mapping = MapViewOfFile(mappingObject, FILE_MAP_READ, 0, 0, 0);
+		if (mapping == nullptr)
+		{
+			std::cerr << "ERROR! Could not map file: " << filename << std::endl;
+			CloseHandle(mappingObject);
+			CloseHandle(file);
+			return;
+		}
+
+		fileHandle = file;
+		mappingHandle = mappingObject;
+		length = static_cast<size_t>(fileSize.QuadPart);
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			std::cerr << "ERROR! Could not open file: " << filename << std::endl;
+			return;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED)
+		{
+			std::cerr << "ERROR! Could not map file: " << filename << std::endl;
+			::close(fd);
+			return;
+		}
+
+		mapping = view;
+		fileDescriptor = fd;
+		length = static_cast<size_t>(info.st_size);
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	void MappedFile::close()
+	{
+#ifdef _WIN32
+		if (mapping)
+			UnmapViewOfFile(mapping);
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		if (fileHandle)
+			CloseHandle(fileHandle);
+		mappingHandle = fileHandle = nullptr;
+#else
+		if (mapping)
+			munmap(mapping, length);
+		if (fileDescriptor >= 0)
+			::close(fileDescriptor);
+		fileDescriptor = -1;
+#endif
+		mapping = nullptr;
+		length = 0;
+	}
+
+	void MappedFile::prefetch(size_t offset, size_t count) const
+	{
+		if (!mapping || offset >= length)
+			return;
+		if (count > length - offset)
+			count = length - offset;
+
+		const char* begin = data() + offset;
+
+#ifdef _WIN32
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<char*>(begin);
+		range.NumberOfBytes = count;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+		// madvise() requires a page-aligned start address.
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const size_t alignedOffset = offset - offset % pageSize;
+		char* alignedBegin = static_cast<char*>(mapping) + alignedOffset;
+		madvise(alignedBegin, count + (offset - alignedOffset), MADV_SEQUENTIAL);
+		madvise(alignedBegin, count + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+
+		// Touch one byte per page so every fault happens now, in order.
+		volatile char sink = 0;
+		for (size_t i = 0; i < count; i += 4096)
+			sink ^= begin[i];
+		sink ^= begin[count - 1];
+	}
+}
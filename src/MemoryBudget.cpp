@@ -0,0 +1,74 @@
+#include "MemoryBudget.h"
+#include <algorithm>
+#include <numeric>
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Evicts entries in 'order' until 'total' fits 'limit'.
+		void Evict(const std::vector<MemoryBudget::Entry>& entries, const std::vector<size_t>& order, size_t frame, size_t limit,
+			size_t MemoryBudget::Entry::* bytes, bool MemoryBudget::Entry::* evictable, size_t& total, std::vector<size_t>& evictions)
+		{
+			for (size_t i = 0; i < order.size() && limit > 0 && total > limit; ++i)
+			{
+				const MemoryBudget::Entry& entry = entries[order[i]];
+				if (entry.lastDrawn >= frame)
+					break;
+				if (entry.*evictable && entry.*bytes > 0)
+				{
+					evictions.push_back(order[i]);
+					total -= entry.*bytes;
+				}
+			}
+		}
+	}
+
+	bool parseResidency(const std::string& name, Residency& residency)
+	{
+		const Residency residencies[] = { Residency::Keep, Residency::Release, Residency::Spill };
+		for (Residency candidate : residencies)
+		{
+			if (name == residencyName(candidate))
+			{
+				residency = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const char* residencyName(Residency residency)
+	{
+		switch (residency)
+		{
+		case Residency::Release:
+			return "release";
+		case Residency::Spill:
+			return "spill";
+		default:
+			return "keep";
+		}
+	}
+
+	bool MemoryBudget::plan(const std::vector<Entry>& entries, size_t frame, std::vector<size_t>& hostEvictions, std::vector<size_t>& gpuEvictions)
+	{
+		hostEvictions.clear();
+		gpuEvictions.clear();
+		hostTotal = gpuTotal = 0;
+		for (const Entry& entry : entries)
+		{
+			hostTotal += entry.hostBytes;
+			gpuTotal += entry.gpuBytes;
+		}
+
+		std::vector<size_t> order(entries.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].lastDrawn < entries[b].lastDrawn; });
+
+		Evict(entries, order, frame, hostLimit, &Entry::hostBytes, &Entry::hostEvictable, hostTotal, hostEvictions);
+		Evict(entries, order, frame, gpuLimit, &Entry::gpuBytes, &Entry::gpuEvictable, gpuTotal, gpuEvictions);
+
+		return (hostLimit == 0 || hostTotal <= hostLimit) && (gpuLimit == 0 || gpuTotal <= gpuLimit);
+	}
+}
@@ -0,0 +1,237 @@
+#include "MortonOrder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Fewest elements a worker codes, sorts or permutes, so small clouds stay on the calling thread.
+		const size_t ORDER_GRAIN = 1u << 16;
+
+		// Bits sorted per radix pass.
+		const unsigned int RADIX_BITS = 8;
+		const size_t RADIX = size_t(1) << RADIX_BITS;
+
+		// Spreads the low 21 bits of 'value' to every third bit.
+		uint64_t SpreadBits(uint64_t value)
+		{
+			value &= 0x1fffff;
+			value = (value | value << 32) & 0x1f00000000ffffull;
+			value = (value | value << 16) & 0x1f0000ff0000ffull;
+			value = (value | value << 8) & 0x100f00f00f00f00full;
+			value = (value | value << 4) & 0x10c30c30c30c30c3ull;
+			value = (value | value << 2) & 0x1249249249249249ull;
+			return value;
+		}
+
+		uint64_t Quantize(float coordinate, float min, float scale)
+		{
+			const uint64_t last = (uint64_t(1) << MORTON_BITS) - 1;
+			const float steps = (coordinate - min) * scale;
+			if (!(steps > 0))
+				return 0;
+			return steps < static_cast<float>(last) ? static_cast<uint64_t>(steps) : last;
+		}
+
+		size_t SliceCount(size_t count)
+		{
+			return std::max<size_t>(1, std::min<size_t>(workerCount(), count / ORDER_GRAIN));
+		}
+	}
+
+	uint64_t mortonCode(uint64_t x, uint64_t y, uint64_t z)
+	{
+		return SpreadBits(x) | SpreadBits(y) << 1 | SpreadBits(z) << 2;
+	}
+
+	bool finiteBounds(const glm::vec3* points, size_t count, glm::vec3& min, glm::vec3& max)
+	{
+		const size_t slices = SliceCount(count);
+		std::vector<glm::vec3> minimum(slices, glm::vec3(std::numeric_limits<float>::max()));
+		std::vector<glm::vec3> maximum(slices, glm::vec3(-std::numeric_limits<float>::max()));
+		parallelFor(0, slices, 1, [&](size_t first, size_t last)
+		{
+			for (size_t s = first; s < last; ++s)
+			{
+				for (size_t i = count * s / slices, end = count * (s + 1) / slices; i < end; ++i)
+				{
+					const glm::vec3& p = points[i];
+					if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+						continue;
+					for (int c = 0; c < 3; ++c)
+					{
+						minimum[s][c] = std::min(minimum[s][c], p[c]);
+						maximum[s][c] = std::max(maximum[s][c], p[c]);
+					}
+				}
+			}
+		});
+
+		min = minimum[0];
+		max = maximum[0];
+		for (size_t s = 1; s < slices; ++s)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				min[c] = std::min(min[c], minimum[s][c]);
+				max[c] = std::max(max[c], maximum[s][c]);
+			}
+		}
+		return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+	}
+
+	void computeMortonCodes(const glm::vec3* points, size_t count, const glm::vec3& min, const glm::vec3& max, uint64_t* codes)
+	{
+		const float steps = static_cast<float>((uint64_t(1) << MORTON_BITS) - 1);
+		float scale[3];
+		for (int c = 0; c < 3; ++c)
+			scale[c] = max[c] > min[c] ? steps / (max[c] - min[c]) : 0.0f;
+
+		parallelFor(0, count, ORDER_GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				codes[i] = mortonCode(Quantize(points[i].x, min.x, scale[0]), Quantize(points[i].y, min.y, scale[1]),
+					Quantize(points[i].z, min.z, scale[2]));
+			}
+		});
+	}
+
+	void radixSortOrder(const uint64_t* keys, size_t count, std::vector<size_t>& order)
+	{
+		// Each slice counts its digits, then scatters into the ranges the counts of all slices reserve for it,
+		// which keeps every pass stable. The first pass reads 'keys' and the identity order in place.
+		const size_t slices = SliceCount(count);
+		std::vector<size_t> counts(slices * RADIX);
+		std::vector<uint64_t> keyBuffers[2];
+		std::vector<size_t> indexBuffers[2];
+		const uint64_t* sourceKeys = keys;
+		const size_t* sourceIndices = nullptr;
+		int target = 0;
+
+		for (unsigned int shift = 0; shift < 64; shift += RADIX_BITS)
+		{
+			parallelFor(0, slices, 1, [&](size_t first, size_t last)
+			{
+				for (size_t s = first; s < last; ++s)
+				{
+					size_t* histogram = counts.data() + s * RADIX;
+					std::fill(histogram, histogram + RADIX, size_t(0));
+					for (size_t i = count * s / slices, end = count * (s + 1) / slices; i < end; ++i)
+						++histogram[(sourceKeys[i] >> shift) & (RADIX - 1)];
+				}
+			});
+
+			size_t offset = 0;
+			bool uniform = false;
+			for (size_t digit = 0; digit < RADIX && !uniform; ++digit)
+			{
+				size_t total = 0;
+				for (size_t s = 0; s < slices; ++s)
+				{
+					const size_t digits = counts[s * RADIX + digit];
+					counts[s * RADIX + digit] = offset;
+					offset += digits;
+					total += digits;
+				}
+				uniform = total == count;
+			}
+			if (uniform)
+				continue;
+
+			keyBuffers[target].resize(count);
+			indexBuffers[target].resize(count);
+			uint64_t* targetKeys = keyBuffers[target].data();
+			size_t* targetIndices = indexBuffers[target].data();
+			parallelFor(0, slices, 1, [&](size_t first, size_t last)
+			{
+				for (size_t s = first; s < last; ++s)
+				{
+					size_t* position = counts.data() + s * RADIX;
+					for (size_t i = count * s / slices, end = count * (s + 1) / slices; i < end; ++i)
+					{
+						const size_t destination = position[(sourceKeys[i] >> shift) & (RADIX - 1)]++;
+						targetKeys[destination] = sourceKeys[i];
+						targetIndices[destination] = sourceIndices ? sourceIndices[i] : i;
+					}
+				}
+			});
+
+			sourceKeys = targetKeys;
+			sourceIndices = targetIndices;
+			target ^= 1;
+		}
+
+		if (sourceIndices)
+			order = std::move(indexBuffers[target ^ 1]);
+		else
+		{
+			order.resize(count);
+			std::iota(order.begin(), order.end(), size_t(0));
+		}
+	}
+
+	bool mortonOrder(const glm::vec3* points, size_t count, std::vector<size_t>& order)
+	{
+		order.clear();
+		if (count < 2)
+			return false;
+
+		// Non-finite points are left out of the bounds, so they cannot make the codes depend on where in the
+		// cloud they are.
+		glm::vec3 min, max;
+		finiteBounds(points, count, min, max);
+		std::vector<uint64_t> codes(count);
+		computeMortonCodes(points, count, min, max, codes.data());
+		if (std::is_sorted(codes.begin(), codes.end()))
+			return false;
+
+		radixSortOrder(codes.data(), count, order);
+		return true;
+	}
+
+	void applyOrder(const std::vector<size_t>& order, std::vector<glm::vec3>& points)
+	{
+		std::vector<glm::vec3> sorted(order.size());
+		parallelFor(0, order.size(), ORDER_GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+				sorted[i] = points[order[i]];
+		});
+		points.swap(sorted);
+	}
+
+	void applyOrder(const std::vector<size_t>& order, PointColumns& columns)
+	{
+		std::vector<char> sorted;
+		for (int f = 0; f < static_cast<int>(columns.fieldCount()); ++f)
+		{
+			const size_t stride = columns.field(f).stride();
+			const char* column = columns.column(f);
+			sorted.resize(order.size() * stride);
+			parallelFor(0, order.size(), ORDER_GRAIN, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					std::memcpy(sorted.data() + i * stride, column + order[i] * stride, stride);
+			});
+			std::memcpy(columns.column(f), sorted.data(), sorted.size());
+		}
+	}
+
+	bool sortMorton(std::vector<glm::vec3>& points, PointColumns* columns)
+	{
+		std::vector<size_t> order;
+		if (!mortonOrder(points.data(), points.size(), order))
+			return false;
+
+		applyOrder(order, points);
+		if (columns && columns->size() == points.size())
+			applyOrder(order, *columns);
+		return true;
+	}
+}
@@ -0,0 +1,324 @@
+#include "Octree.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "CloudCache.h"
+#include "CsvLoader.h"
+#include "PCDparser.h"
+#include "Parallel.h"
+#include "PointStatistics.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		const char OCTREE_MAGIC[8] = { 'P', 'C', 'V', 'O', 'C', 'T', 'R', 'E' };
+		const uint32_t OCTREE_VERSION = 1;
+		const size_t OCTREE_ALIGNMENT = 64;
+
+		// Subtrees at least this large build their children in parallel.
+		const size_t PARALLEL_POINTS = 1u << 20;
+
+		size_t AlignUp(size_t offset)
+		{
+			return (offset + OCTREE_ALIGNMENT - 1) & ~(OCTREE_ALIGNMENT - 1);
+		}
+
+		void WritePadding(std::ofstream& out, size_t target)
+		{
+			static const char zeros[OCTREE_ALIGNMENT] = {};
+			size_t position = static_cast<size_t>(out.tellp());
+			if (target > position)
+				out.write(zeros, target - position);
+		}
+
+		unsigned int CellIndex(float coordinate)
+		{
+			if (!(coordinate > 0))
+				return 0;
+			return std::min(static_cast<unsigned int>(coordinate), Octree::SAMPLE_GRID - 1);
+		}
+
+		// Moves the first point of every occupied grid cell to the front of [begin, end) and returns the end of them.
+		size_t Subsample(std::vector<glm::vec3>& points, size_t begin, size_t end, glm::vec3 center, float halfSize)
+		{
+			const size_t grid = Octree::SAMPLE_GRID;
+			const glm::vec3 origin = center - glm::vec3(halfSize);
+			const float scale = grid / (2 * halfSize);
+			std::vector<uint64_t> occupied(grid * grid * grid / 64);
+
+			size_t kept = begin;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const glm::vec3 cell = (points[i] - origin) * scale;
+				const size_t key = (CellIndex(cell.x) * grid + CellIndex(cell.y)) * grid + CellIndex(cell.z);
+				const uint64_t bit = 1ull << (key & 63);
+				if (occupied[key >> 6] & bit)
+					continue;
+				occupied[key >> 6] |= bit;
+				std::swap(points[i], points[kept++]);
+			}
+			return kept;
+		}
+
+		// Builds the subtree of the points in [begin, end), depth first, with child indices relative to its root.
+		std::vector<Octree::Node> BuildSubtree(std::vector<glm::vec3>& points, size_t begin, size_t end, glm::vec3 center, float halfSize, unsigned int depth)
+		{
+			Octree::Node node = {};
+			for (int i = 0; i < 3; ++i)
+				node.center[i] = center[i];
+			node.halfSize = halfSize;
+			node.spacing = 2 * halfSize / Octree::SAMPLE_GRID;
+			node.depth = depth;
+			node.first = begin;
+			std::fill(node.children, node.children + 8, -1);
+
+			if (end - begin <= Octree::LEAF_POINTS || depth >= Octree::MAX_DEPTH)
+			{
+				node.count = end - begin;
+				return std::vector<Octree::Node>(1, node);
+			}
+
+			const size_t kept = Subsample(points, begin, end, center, halfSize);
+			node.count = kept - begin;
+
+			// Partition the remaining points into octants x, then y, then z, so octant o = x * 4 + y * 2 + z.
+			auto split = [&](size_t lo, size_t hi, int axis)
+			{
+				return static_cast<size_t>(std::partition(points.begin() + lo, points.begin() + hi,
+					[&](const glm::vec3& p) { return p[axis] < center[axis]; }) - points.begin());
+			};
+			size_t bounds[9];
+			bounds[0] = kept;
+			bounds[8] = end;
+			bounds[4] = split(bounds[0], bounds[8], 0);
+			bounds[2] = split(bounds[0], bounds[4], 1);
+			bounds[6] = split(bounds[4], bounds[8], 1);
+			for (int o = 1; o < 8; o += 2)
+				bounds[o] = split(bounds[o - 1], bounds[o + 1], 2);
+
+			std::vector<std::vector<Octree::Node>> subtrees(8);
+			auto buildChildren = [&](size_t first, size_t last)
+			{
+				for (size_t o = first; o < last; ++o)
+				{
+					if (bounds[o + 1] == bounds[o])
+						continue;
+					const glm::vec3 direction((o & 4) ? 1.0f : -1.0f, (o & 2) ? 1.0f : -1.0f, (o & 1) ? 1.0f : -1.0f);
+					subtrees[o] = BuildSubtree(points, bounds[o], bounds[o + 1], center + direction * (halfSize * 0.5f), halfSize * 0.5f, depth + 1);
+				}
+			};
+			if (end - begin >= PARALLEL_POINTS)
+				parallelFor(0, 8, 1, buildChildren);
+			else
+				buildChildren(0, 8);
+
+			std::vector<Octree::Node> tree(1, node);
+			for (int o = 0; o < 8; ++o)
+			{
+				if (subtrees[o].empty())
+					continue;
+				const int32_t base = static_cast<int32_t>(tree.size());
+				tree[0].children[o] = base;
+				for (Octree::Node child : subtrees[o])
+				{
+					for (int32_t& index : child.children)
+					{
+						if (index >= 0)
+							index += base;
+					}
+					tree.push_back(child);
+				}
+			}
+			return tree;
+		}
+	}
+
+	std::string Octree::octreePath(const std::string& sourceFilename)
+	{
+		return sourceFilename + ".pcvoctree";
+	}
+
+	bool Octree::build(const std::string& sourceFilename, std::vector<glm::vec3>& points)
+	{
+		Header header = {};
+		std::memcpy(header.magic, OCTREE_MAGIC, sizeof(OCTREE_MAGIC));
+		header.version = OCTREE_VERSION;
+		header.pointCount = points.size();
+		if (!CloudCache::sourceSignature(sourceFilename, header.sourceSize, header.sourceTime, header.sourceChecksum))
+			return false;
+
+		// The root is the bounding cube of the cloud, grown slightly so no point lies on its far faces.
+		PointStatistics statistics = computeStatistics(points.data(), points.size());
+		const glm::vec3 extent = statistics.extent();
+		float halfSize = std::max(extent.x, std::max(extent.y, extent.z)) * 0.5f * 1.001f;
+		if (!(halfSize > 0))
+			halfSize = 1.0f;
+		const glm::vec3 center = points.empty() ? glm::vec3(0) : (statistics.min() + statistics.max()) * 0.5f;
+
+		std::vector<Node> nodes = BuildSubtree(points, 0, points.size(), center, halfSize, 0);
+		header.nodeCount = static_cast<uint32_t>(nodes.size());
+		header.nodesOffset = sizeof(Header);
+		header.pointsOffset = AlignUp(header.nodesOffset + nodes.size() * sizeof(Node));
+
+		const std::string path = octreePath(sourceFilename);
+		const std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream out(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			if (!out.is_open())
+			{
+				std::cerr << "ERROR! Could not write octree file: " << temporaryPath << std::endl;
+				return false;
+			}
+
+			out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(Node));
+			WritePadding(out, header.pointsOffset);
+			if (!points.empty())
+				out.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(glm::vec3));
+
+			if (!out.good())
+			{
+				out.close();
+				std::remove(temporaryPath.c_str());
+				std::cerr << "ERROR! Could not write octree file: " << temporaryPath << std::endl;
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			std::remove(temporaryPath.c_str());
+			std::cerr << "ERROR! Could not write octree file: " << path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Octree::buildFromSource(const std::string& sourceFilename)
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::string extension = sourceFilename.substr(std::min(sourceFilename.rfind("."), sourceFilename.size()));
+
+		std::vector<glm::vec3> points;
+		CloudCache cache;
+		if (cache.open(sourceFilename))
+			points.assign(cache.positions(), cache.positions() + cache.size());
+		else if (extension == ".pcd")
+		{
+			PCDparser::PCDparser pcdParser(sourceFilename);
+			points = std::move(pcdParser.points);
+		}
+		else if (extension == ".csv")
+		{
+			CsvLoader csvLoader(sourceFilename);
+			if (!csvLoader.load(points))
+			{
+				std::cerr << "ERROR! Could not load " << sourceFilename << " to build its octree." << std::endl;
+				return false;
+			}
+		}
+		else
+		{
+			std::cerr << "ERROR! Octrees can only be built from pcd and csv files: " << sourceFilename << std::endl;
+			return false;
+		}
+		cache.close();
+
+		points.erase(std::remove_if(points.begin(), points.end(), [](const glm::vec3& p)
+		{
+			return !std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z);
+		}), points.end());
+
+		std::cout << "Building octree of " << points.size() << " points from " << sourceFilename << "." << std::endl;
+		if (!build(sourceFilename, points))
+			return false;
+
+		std::cout << "Wrote " << octreePath(sourceFilename) << " in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms." << std::endl;
+		return true;
+	}
+
+	bool Octree::isCurrent(const std::string& sourceFilename)
+	{
+		Octree octree;
+		return octree.open(sourceFilename);
+	}
+
+	bool Octree::open(const std::string& sourceFilename)
+	{
+		close();
+
+		const std::string path = octreePath(sourceFilename);
+		std::error_code error;
+		if (!std::filesystem::exists(path, error))
+			return false;
+
+		uint64_t sourceSize = 0, sourceChecksum = 0;
+		int64_t sourceTime = 0;
+		if (!CloudCache::sourceSignature(sourceFilename, sourceSize, sourceTime, sourceChecksum))
+			return false;
+
+		std::unique_ptr<MappedFile> mapped(new MappedFile(path));
+		if (!mapped->isOpen() || mapped->size() < sizeof(Header))
+			return false;
+
+		const Header* candidate = reinterpret_cast<const Header*>(mapped->data());
+		if (std::memcmp(candidate->magic, OCTREE_MAGIC, sizeof(OCTREE_MAGIC)) != 0 || candidate->version != OCTREE_VERSION)
+			return false;
+		if (candidate->sourceSize != sourceSize || candidate->sourceTime != sourceTime || candidate->sourceChecksum != sourceChecksum)
+		{
+			std::cout << "Octree " << path << " is stale, it has to be built again." << std::endl;
+			return false;
+		}
+
+		// Every referenced range has to lie inside the mapping, and every child inside the node table.
+		if (candidate->nodeCount == 0 || candidate->nodesOffset + uint64_t(candidate->nodeCount) * sizeof(Node) > mapped->size() ||
+			candidate->pointsOffset + candidate->pointCount * sizeof(glm::vec3) > mapped->size())
+			return false;
+		const Node* table = reinterpret_cast<const Node*>(mapped->data() + candidate->nodesOffset);
+		for (uint32_t i = 0; i < candidate->nodeCount; ++i)
+		{
+			if (table[i].first + table[i].count > candidate->pointCount)
+				return false;
+			for (int32_t child : table[i].children)
+			{
+				if (child >= 0 && (static_cast<uint32_t>(child) <= i || static_cast<uint32_t>(child) >= candidate->nodeCount))
+					return false;
+			}
+		}
+
+		file = std::move(mapped);
+		header = candidate;
+		nodes = table;
+		return true;
+	}
+
+	void Octree::close()
+	{
+		header = nullptr;
+		nodes = nullptr;
+		file.reset();
+	}
+
+	const glm::vec3* Octree::points(const Node& node) const
+	{
+		if (!header)
+			return nullptr;
+		return reinterpret_cast<const glm::vec3*>(file->data() + header->pointsOffset) + node.first;
+	}
+
+	void Octree::prefetch(const Node& node) const
+	{
+		if (header && node.count > 0)
+			file->prefetch(static_cast<size_t>(header->pointsOffset + node.first * sizeof(glm::vec3)), static_cast<size_t>(node.count * sizeof(glm::vec3)));
+	}
+}
@@ -0,0 +1,203 @@
+#include "OctreeCloud.h"
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Page-ins in flight at once, so a fast camera move does not queue reads for nodes it has already left.
+		const size_t MAX_LOADS = 16;
+
+		// Closest distance used for the projected spacing of nodes the camera is inside of.
+		const float MIN_DISTANCE = 1e-3f;
+
+		bool InFrustum(const Frustum& frustum, const Octree::Node& node)
+		{
+			const glm::vec3 center(node.center[0], node.center[1], node.center[2]);
+			return frustum.intersects(center - glm::vec3(node.halfSize), center + glm::vec3(node.halfSize));
+		}
+	}
+
+	OctreeCloud::~OctreeCloud()
+	{
+		release();
+	}
+
+	bool OctreeCloud::open(const std::string& sourceFilename)
+	{
+		release();
+		if (!octree.open(sourceFilename))
+			return false;
+		states.assign(octree.nodeCount(), NodeState());
+		return true;
+	}
+
+	void OctreeCloud::update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+		size_t& pointBudget, size_t& budgetBytes)
+	{
+		++frame;
+		selected.clear();
+		drawList.clear();
+		drawnCount = 0;
+		if (!octree.isOpen() || !visible)
+			return;
+
+		loading.erase(std::remove_if(loading.begin(), loading.end(), [&](uint32_t index) { return JobSystem::isDone(states[index].load); }), loading.end());
+
+		// Everything is measured in model space: the camera is moved into it, and a node's spacing in pixels is
+		// spacing * pixelsPerUnit / distance.
+		const glm::mat4 modelView = view * model;
+		const glm::vec4 eye = glm::inverse(modelView) * glm::vec4(0, 0, 0, 1);
+		const glm::vec3 camera(eye.x, eye.y, eye.z);
+		const float pixelsPerUnit = 0.5f * viewportHeight * projection[1][1];
+		const Frustum frustum(projection * modelView);
+
+		// Refine the nodes with the coarsest projected spacing first. A node is only queued once its parent is
+		// selected, so the selection always shows the whole cloud at some level.
+		std::priority_queue<std::pair<float, uint32_t>> queue;
+		auto visit = [&](uint32_t index)
+		{
+			const Octree::Node& node = octree.node(index);
+			if (!InFrustum(frustum, node))
+				return;
+			const glm::vec3 center(node.center[0], node.center[1], node.center[2]);
+			const float distance = std::max(glm::length(center - camera) - node.halfSize * 1.7320508f, MIN_DISTANCE);
+			queue.push(std::make_pair(node.spacing * pixelsPerUnit / distance, index));
+		};
+		visit(0);
+
+		size_t points = 0;
+		while (!queue.empty())
+		{
+			const float error = queue.top().first;
+			const uint32_t index = queue.top().second;
+			queue.pop();
+
+			const Octree::Node& node = octree.node(index);
+			if (points + node.count > pointBudget)
+				break;
+			selected.push_back(index);
+			points += node.count;
+
+			if (error > maxScreenError)
+			{
+				for (int32_t child : node.children)
+				{
+					if (child >= 0)
+						visit(static_cast<uint32_t>(child));
+				}
+			}
+		}
+		pointBudget -= points;
+
+		// Draw what is resident, page in what is not, and upload what has been paged in.
+		for (uint32_t index : selected)
+		{
+			NodeState& state = states[index];
+			state.lastUsed = frame;
+			if (!state.VBO)
+			{
+				if (!state.load)
+				{
+					if (loading.size() < MAX_LOADS)
+					{
+						state.load = JobSystem::current().submit([this, index] { octree.prefetch(octree.node(index)); });
+						loading.push_back(index);
+					}
+					continue;
+				}
+				if (!JobSystem::isDone(state.load) || budgetBytes == 0)
+					continue;
+				Upload(index, budgetBytes);
+			}
+			drawList.push_back(index);
+			drawnCount += octree.node(index).count;
+		}
+
+		EvictNodes();
+	}
+
+	void OctreeCloud::draw() const
+	{
+		for (uint32_t index : drawList)
+		{
+			glBindVertexArray(states[index].VAO);
+			glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(octree.node(index).count));
+		}
+		glBindVertexArray(0);
+	}
+
+	void OctreeCloud::release()
+	{
+		// The page-in jobs read the mapping, so it has to outlive them.
+		for (uint32_t index : loading)
+			JobSystem::current().wait(states[index].load);
+		loading.clear();
+
+		for (NodeState& state : states)
+		{
+			if (state.VAO) { glDeleteVertexArrays(1, &state.VAO); }
+			if (state.VBO) { glDeleteBuffers(1, &state.VBO); }
+			state = NodeState();
+		}
+		residentBytes = 0;
+		selected.clear();
+		drawList.clear();
+		drawnCount = 0;
+	}
+
+	void OctreeCloud::Upload(uint32_t index, size_t& budgetBytes)
+	{
+		NodeState& state = states[index];
+		const Octree::Node& node = octree.node(index);
+		const size_t bytes = static_cast<size_t>(node.count) * sizeof(glm::vec3);
+
+		glGenVertexArrays(1, &state.VAO);
+		glGenBuffers(1, &state.VBO);
+		glBindVertexArray(state.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, state.VBO);
+		glBufferData(GL_ARRAY_BUFFER, bytes, octree.points(node), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		state.load.reset();
+		residentBytes += bytes;
+		budgetBytes -= std::min(budgetBytes, bytes);
+	}
+
+	void OctreeCloud::EvictNodes()
+	{
+		if (residentBytes <= cacheBytes)
+			return;
+
+		std::vector<uint32_t> resident;
+		std::vector<MemoryBudget::Entry> entries;
+		for (uint32_t i = 0; i < states.size(); ++i)
+		{
+			if (!states[i].VBO)
+				continue;
+			MemoryBudget::Entry entry;
+			entry.gpuBytes = static_cast<size_t>(octree.node(i).count) * sizeof(glm::vec3);
+			entry.lastDrawn = states[i].lastUsed;
+			entry.gpuEvictable = true;
+			resident.push_back(i);
+			entries.push_back(entry);
+		}
+
+		cache.gpuLimit = cacheBytes;
+		std::vector<size_t> hostEvictions, gpuEvictions;
+		cache.plan(entries, frame, hostEvictions, gpuEvictions);
+		for (size_t entry : gpuEvictions)
+		{
+			NodeState& state = states[resident[entry]];
+			glDeleteVertexArrays(1, &state.VAO);
+			glDeleteBuffers(1, &state.VBO);
+			state.VAO = state.VBO = 0;
+			residentBytes -= entries[entry].gpuBytes;
+		}
+	}
+}
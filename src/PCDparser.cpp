@@ -1,46 +1,315 @@
 #include "stdafx.h"
 #include "PCDparser.h"
-#include <fstream>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "AsciiParser.h"
+#include "LZF.h"
+#include "MappedFile.h"
+#include "Parallel.h"
 #include "StringUtils.h"
 
 
 namespace PCDparser
 {
+	namespace
+	{
+		double MillisecondsSince(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// Parses a whole header value as a positive integer; "0", "-1", "4x" or out of range values are rejected.
+		template<typename T>
+		bool ParsePositive(std::string_view text, T& value)
+		{
+			const char* end = text.data() + text.size();
+			std::from_chars_result result = std::from_chars(text.data(), end, value);
+			return result.ec == std::errc() && result.ptr == end && value > 0;
+		}
+	}
+
 	PCDparser::PCDparser(std::string filename)
 	{
-		std::ifstream infile(filename, std::ios::binary | std::ios::in);
-		std::string inputBuffer = "";
-		bool parsingHeader = true;
+		auto start = std::chrono::steady_clock::now();
+		PointcloudVisualizer::MappedFile file(filename);
+		if (!file.isOpen())
+			return;
+
+		size_t bodyOffset = 0;
+		if (!ParseHeader(file.data(), file.data() + file.size(), bodyOffset))
+			return;
+		timings.mapMs = MillisecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		file.prefetch(bodyOffset);
+		timings.pageInMs = MillisecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		const char* body = file.data() + bodyOffset;
+		size_t bodySize = file.size() - bodyOffset;
+		if (header.dataFormat == "ascii")
+			ParseAscii(body, bodySize);
+		else if (header.dataFormat == "binary")
+			ParseBinary(body, bodySize);
+		else if (header.dataFormat == "binary_compressed")
+		{
+			if (!ParseCompressed(body, bodySize))
+				return;
+		}
+		else
+		{
+			std::cerr << "ERROR! Unsupported PCD data format: '" << header.dataFormat << "'." << std::endl;
+			return;
+		}
+
+		if (!columns.gatherPositions(points))
+			std::cerr << "ERROR! PCD file has no x/y/z fields." << std::endl;
+		timings.decodeMs = MillisecondsSince(start);
+
+		std::cout << "Loaded " << points.size() << " " << header.dataFormat << " PCD points: cold " << timings.cold()
+			<< " ms (page-in " << timings.pageInMs << " ms), warm estimate " << timings.warm() << " ms (map + decode)." << std::endl;
+	}
+
+	bool PCDparser::ParseHeader(const char* begin, const char* end, size_t& bodyOffset)
+	{
+		const char* cursor = begin;
+		std::vector<std::string> sizes, types, counts;
+		std::vector<std::string_view> parsedLine;
 
-		while (std::getline(infile, inputBuffer))
+		while (cursor < end)
 		{
+			const char* lineEnd = PointcloudVisualizer::findFirstOf(cursor, end, "\n");
+			std::string_view line(cursor, lineEnd - cursor);
+			cursor = lineEnd < end ? lineEnd + 1 : end;
+
 			// Skip commented lines (denoted by a # char).
-			if (inputBuffer.size() > 0 && inputBuffer[0] == '#')
+			if (line.size() == 0 || line[0] == '#')
+				continue;
+
+			if (PointcloudVisualizer::tokenizeView(line, " \t\r", parsedLine) == 0)
 				continue;
 
-			std::string firstEntry = inputBuffer.substr(0, inputBuffer.find(" "));
-			if (IsHeaderString(firstEntry) < 0)
+			int entry = IsHeaderString(std::string(parsedLine[0]));
+			if (entry < 0)
+			{
+				std::cerr << "ERROR! Unexpected PCD header line: '" << line << "'." << std::endl;
+				return false;
+			}
+			if (parsedLine.size() < 2)
+			{
+				std::cerr << "ERROR! PCD header entry " << HeaderEntry[entry] << " has no value." << std::endl;
+				return false;
+			}
+
+			switch (entry)
 			{
-				parsingHeader = false;
+			case 0: // VERSION
+				header.version = std::string(parsedLine[1]);
+				break;
+			case 1: // FIELDS
+				header.fields.resize(parsedLine.size() - 1);
+				for (unsigned int i = 1; i < parsedLine.size(); ++i)
+					header.fields[i - 1].name = std::string(parsedLine[i]);
+				break;
+			case 2: // SIZE
+				sizes.assign(parsedLine.begin() + 1, parsedLine.end());
+				break;
+			case 3: // TYPE
+				types.assign(parsedLine.begin() + 1, parsedLine.end());
+				break;
+			case 4: // COUNT
+				counts.assign(parsedLine.begin() + 1, parsedLine.end());
+				break;
+			case 5: // WIDTH
+				header.width = std::atoi(std::string(parsedLine[1]).c_str());
+				break;
+			case 6: // HEIGHT
+				header.height = std::atoi(std::string(parsedLine[1]).c_str());
+				break;
+			case 7: // VIEWPOINT
+				for (unsigned int i = 1; i < parsedLine.size() && i <= 7; ++i)
+					header.viewpoint[i - 1] = std::strtof(std::string(parsedLine[i]).c_str(), nullptr);
+				break;
+			case 8: // POINTS
+				if (!ParsePositive(parsedLine[1], header.points))
+				{
+					std::cerr << "ERROR! PCD POINTS must be a positive integer, not '" << parsedLine[1] << "'." << std::endl;
+					return false;
+				}
+				break;
+			case 9: // DATA, always the last header line.
+				header.dataFormat = std::string(parsedLine[1]);
+				bodyOffset = cursor - begin;
+				break;
 			}
 
-			std::vector<std::string> parsedLine = PointcloudVisualizer::tokenize(inputBuffer, " ");
-			std::vector<float> currentPoint;
+			if (entry == 9)
+				break;
+		}
+
+		if (header.dataFormat.empty())
+		{
+			std::cerr << "ERROR! PCD header has no DATA line." << std::endl;
+			return false;
+		}
 
-			if (parsingHeader)
+		// SIZE/TYPE default to 4-byte floats and COUNT to 1 when a line is missing (pre-0.7 files).
+		const size_t fieldCount = header.fields.size();
+		if ((sizes.size() && sizes.size() != fieldCount) || (types.size() && types.size() != fieldCount) ||
+			(counts.size() && counts.size() != fieldCount))
+		{
+			std::cerr << "ERROR! PCD SIZE/TYPE/COUNT entries do not match the " << fieldCount << " FIELDS." << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < fieldCount; ++i)
+		{
+			PointcloudVisualizer::FieldSchema& field = header.fields[i];
+			if ((sizes.size() && !ParsePositive(sizes[i], field.size)) || (counts.size() && !ParsePositive(counts[i], field.count)))
 			{
-				// Handle header entries. TO DO: implement
+				std::cerr << "ERROR! PCD field '" << field.name << "' has a SIZE or COUNT that is not a positive integer." << std::endl;
+				return false;
 			}
-			else
+			if (types.size()) field.type = types[i][0];
+
+			bool validSize = field.size == 1 || field.size == 2 || field.size == 4 || field.size == 8;
+			bool validType = field.type == 'F' ? (field.size == 4 || field.size == 8) : (field.type == 'I' || field.type == 'U');
+			if (!validSize || !validType || field.count == 0)
 			{
-				for (unsigned int i = 0; i < parsedLine.size(); ++i)
-					currentPoint.push_back(std::stof(parsedLine[i]));
+				std::cerr << "ERROR! PCD field '" << field.name << "' has unsupported SIZE/TYPE/COUNT." << std::endl;
+				return false;
+			}
+		}
 
-				data.push_back(currentPoint);
+		size_t gridPoints = static_cast<size_t>(header.width) * (header.height > 0 ? header.height : 1);
+		if (header.points == 0)
+			header.points = gridPoints;
+		else if (gridPoints != 0 && gridPoints != header.points)
+			std::cerr << "WARNING: PCD POINTS (" << header.points << ") differs from WIDTH*HEIGHT (" << gridPoints << ")." << std::endl;
+
+		return true;
+	}
+
+	void PCDparser::ParseAscii(const char* body, size_t size)
+	{
+		// Values are listed field by field, COUNT values each.
+		size_t valuesPerRow = 0;
+		for (unsigned int i = 0; i < header.fields.size(); ++i)
+			valuesPerRow += header.fields[i].count;
+
+		PointcloudVisualizer::AsciiChunkParser parser(body, body + size, ' ', valuesPerRow);
+		size_t pointCount = std::min(parser.rows(), header.points);
+		if (pointCount < header.points)
+			std::cerr << "WARNING: PCD body holds " << pointCount << " of " << header.points << " points." << std::endl;
+
+		columns.allocate(header.fields, pointCount);
+		parser.parse([&](size_t row, const double* values)
+		{
+			for (int f = 0; f < static_cast<int>(header.fields.size()); ++f)
+			{
+				for (unsigned int e = 0; e < header.fields[f].count; ++e)
+					columns.set(f, row, e, *values++);
 			}
+		}, pointCount);
+	}
+
+	void PCDparser::ParseBinary(const char* body, size_t size)
+	{
+		size_t recordSize = 0;
+		std::vector<size_t> recordOffsets(header.fields.size());
+		for (unsigned int i = 0; i < header.fields.size(); ++i)
+		{
+			recordOffsets[i] = recordSize;
+			recordSize += header.fields[i].stride();
 		}
-		
-		infile.close();
+		if (recordSize == 0)
+			return;
+
+		size_t pointCount = header.points;
+		size_t available = size / recordSize;
+		if (available < pointCount)
+		{
+			std::cerr << "WARNING: PCD body holds " << available << " of " << pointCount << " points, file is truncated." << std::endl;
+			pointCount = available;
+		}
+
+		columns.allocate(header.fields, pointCount);
+
+		// Transpose records into columns, each thread owning a disjoint range of points.
+		PointcloudVisualizer::parallelFor(0, pointCount, 1 << 16, [&](size_t begin, size_t end)
+		{
+			for (int f = 0; f < static_cast<int>(header.fields.size()); ++f)
+			{
+				const size_t stride = header.fields[f].stride();
+				const char* source = body + begin * recordSize + recordOffsets[f];
+				char* target = columns.column(f) + begin * stride;
+				for (size_t i = begin; i < end; ++i, source += recordSize, target += stride)
+					std::memcpy(target, source, stride);
+			}
+		});
+	}
+
+	bool PCDparser::ParseCompressed(const char* body, size_t size)
+	{
+		// The body is a uint32 compressed size, a uint32 uncompressed size and one LZF stream
+		// holding every field's column back to back.
+		uint32_t compressedSize = 0, uncompressedSize = 0;
+		if (size < 8)
+		{
+			std::cerr << "ERROR! binary_compressed PCD body is truncated." << std::endl;
+			return false;
+		}
+		std::memcpy(&compressedSize, body, 4);
+		std::memcpy(&uncompressedSize, body + 4, 4);
+		if (compressedSize > size - 8)
+		{
+			std::cerr << "ERROR! binary_compressed PCD body is truncated." << std::endl;
+			return false;
+		}
+
+		size_t columnBytes = 0;
+		for (unsigned int i = 0; i < header.fields.size(); ++i)
+			columnBytes += header.points * header.fields[i].stride();
+		if (columnBytes != uncompressedSize || uncompressedSize == 0)
+		{
+			std::cerr << "ERROR! binary_compressed PCD body size does not match its header." << std::endl;
+			return false;
+		}
+
+		// When every packed column happens to be aligned for its type, decompress straight into the store.
+		if (PointcloudVisualizer::PointColumns::packedLayoutIsAligned(header.fields, header.points))
+		{
+			columns.allocate(header.fields, header.points, true);
+			if (PointcloudVisualizer::lzfDecompress(body + 8, compressedSize, columns.raw(), uncompressedSize) != uncompressedSize)
+			{
+				std::cerr << "ERROR! binary_compressed PCD body failed to decompress." << std::endl;
+				columns.clear();
+				return false;
+			}
+			return true;
+		}
+
+		std::vector<char> packed(uncompressedSize);
+		if (PointcloudVisualizer::lzfDecompress(body + 8, compressedSize, packed.data(), uncompressedSize) != uncompressedSize)
+		{
+			std::cerr << "ERROR! binary_compressed PCD body failed to decompress." << std::endl;
+			return false;
+		}
+
+		// Otherwise copy each field's column into its aligned slot, one field per thread.
+		columns.allocate(header.fields, header.points);
+		std::vector<size_t> packedOffsets(header.fields.size());
+		for (size_t i = 1; i < header.fields.size(); ++i)
+			packedOffsets[i] = packedOffsets[i - 1] + header.points * header.fields[i - 1].stride();
+
+		PointcloudVisualizer::parallelFor(0, header.fields.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t f = begin; f < end; ++f)
+				std::memcpy(columns.column(static_cast<int>(f)), packed.data() + packedOffsets[f], columns.columnBytes(static_cast<int>(f)));
+		});
+		return true;
 	}
 
 	int PCDparser::IsHeaderString(std::string entry)
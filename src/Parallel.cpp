@@ -0,0 +1,15 @@
+#include "Parallel.h"
+#include "JobSystem.h"
+
+namespace PointcloudVisualizer
+{
+	unsigned int workerCount()
+	{
+		return JobSystem::current().threadCount();
+	}
+
+	void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body)
+	{
+		JobSystem::current().parallelFor(begin, end, grain, body);
+	}
+}
@@ -0,0 +1,132 @@
+#include "PointColumns.h"
+#include <cstdint>
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		template<typename T> double Load(const char* p) { T v; std::memcpy(&v, p, sizeof(T)); return static_cast<double>(v); }
+		template<typename T> void Store(char* p, double value) { T v = static_cast<T>(value); std::memcpy(p, &v, sizeof(T)); }
+	}
+
+	void PointColumns::allocate(const std::vector<FieldSchema>& schema, size_t points, bool packed)
+	{
+		fields = schema;
+		pointCount = points;
+		offsets.resize(fields.size());
+
+		size_t total = 0;
+		for (unsigned int i = 0; i < fields.size(); ++i)
+		{
+			if (!packed)
+				total = (total + 63) & ~static_cast<size_t>(63);
+			offsets[i] = total;
+			total += points * fields[i].stride();
+		}
+
+		block.clear();
+		block.shrink_to_fit();
+		block.resize(total);
+	}
+
+	bool PointColumns::packedLayoutIsAligned(const std::vector<FieldSchema>& schema, size_t points)
+	{
+		size_t total = 0;
+		for (unsigned int i = 0; i < schema.size(); ++i)
+		{
+			if (schema[i].size > 0 && total % schema[i].size != 0)
+				return false;
+			total += points * schema[i].stride();
+		}
+		return true;
+	}
+
+	void PointColumns::clear()
+	{
+		fields.clear();
+		offsets.clear();
+		block.clear();
+		block.shrink_to_fit();
+		pointCount = 0;
+	}
+
+	int PointColumns::find(const std::string& name) const
+	{
+		for (unsigned int i = 0; i < fields.size(); ++i)
+		{
+			if (fields[i].name == name)
+				return i;
+		}
+
+		return -1;
+	}
+
+	double PointColumns::get(int i, size_t point, unsigned int element) const
+	{
+		const FieldSchema& f = fields[i];
+		const char* p = column(i) + point * f.stride() + element * f.size;
+		switch (f.type)
+		{
+		case 'F':
+			return f.size == 8 ? Load<double>(p) : Load<float>(p);
+		case 'I':
+			switch (f.size) { case 1: return Load<int8_t>(p); case 2: return Load<int16_t>(p); case 8: return Load<int64_t>(p); default: return Load<int32_t>(p); }
+		case 'U':
+			switch (f.size) { case 1: return Load<uint8_t>(p); case 2: return Load<uint16_t>(p); case 8: return Load<uint64_t>(p); default: return Load<uint32_t>(p); }
+		}
+		return 0;
+	}
+
+	void PointColumns::set(int i, size_t point, unsigned int element, double value)
+	{
+		const FieldSchema& f = fields[i];
+		char* p = column(i) + point * f.stride() + element * f.size;
+		switch (f.type)
+		{
+		case 'F':
+			if (f.size == 8) Store<double>(p, value); else Store<float>(p, value);
+			break;
+		case 'I':
+			switch (f.size) { case 1: Store<int8_t>(p, value); break; case 2: Store<int16_t>(p, value); break; case 8: Store<int64_t>(p, value); break; default: Store<int32_t>(p, value); break; }
+			break;
+		case 'U':
+			switch (f.size) { case 1: Store<uint8_t>(p, value); break; case 2: Store<uint16_t>(p, value); break; case 8: Store<uint64_t>(p, value); break; default: Store<uint32_t>(p, value); break; }
+			break;
+		}
+	}
+
+	bool PointColumns::gatherPositions(std::vector<glm::vec3>& positions) const
+	{
+		int x = find("x"), y = find("y"), z = find("z");
+		if (x < 0 || y < 0 || z < 0)
+			return false;
+
+		positions.resize(pointCount);
+		const bool allFloat = fields[x].type == 'F' && fields[x].size == 4 && fields[y].type == 'F' && fields[y].size == 4 &&
+			fields[z].type == 'F' && fields[z].size == 4;
+
+		// Each thread owns a disjoint range of points, so no two threads write the same cache line twice.
+		parallelFor(0, pointCount, 1 << 16, [&](size_t begin, size_t end)
+		{
+			if (allFloat)
+			{
+				const char* xs = column(x) + begin * fields[x].stride();
+				const char* ys = column(y) + begin * fields[y].stride();
+				const char* zs = column(z) + begin * fields[z].stride();
+				for (size_t i = begin; i < end; ++i, xs += fields[x].stride(), ys += fields[y].stride(), zs += fields[z].stride())
+				{
+					std::memcpy(&positions[i].x, xs, 4);
+					std::memcpy(&positions[i].y, ys, 4);
+					std::memcpy(&positions[i].z, zs, 4);
+				}
+				return;
+			}
+
+			for (size_t i = begin; i < end; ++i)
+				positions[i] = glm::vec3(static_cast<float>(get(x, i)), static_cast<float>(get(y, i)), static_cast<float>(get(z, i)));
+		});
+
+		return true;
+	}
+}
@@ -0,0 +1,187 @@
+#include "PointFilters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include "KdTree.h"
+#include "MortonOrder.h"
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Fewest points or voxels a worker handles.
+		const size_t FILTER_GRAIN = 1u << 16;
+
+		// Key of points with non-finite coordinates, sorted behind every voxel.
+		const uint64_t NO_VOXEL = ~uint64_t(0);
+
+		// Points whose neighbours are looked up at once, which bounds the memory the results take.
+		const size_t OUTLIER_BLOCK = 1u << 16;
+	}
+
+	bool voxelDownsample(const glm::vec3* points, size_t count, float voxelSize, VoxelMode mode, std::vector<glm::vec3>& output)
+	{
+		if (!(voxelSize > 0))
+		{
+			std::cerr << "ERROR! Voxel size must be positive, not " << voxelSize << "." << std::endl;
+			return false;
+		}
+
+		glm::vec3 min, max;
+		if (!finiteBounds(points, count, min, max))
+		{
+			output.clear();
+			return true;
+		}
+		const float cells = static_cast<float>(uint64_t(1) << MORTON_BITS);
+		for (int c = 0; c < 3; ++c)
+		{
+			if ((max[c] - min[c]) / voxelSize >= cells)
+			{
+				std::cerr << "ERROR! Voxel size " << voxelSize << " is too small for a cloud " << max[c] - min[c] << " wide." << std::endl;
+				return false;
+			}
+		}
+
+		// The points of a voxel share the Morton code of its grid cell, so sorting the codes groups them, in
+		// file order within the voxel, and puts neighbouring voxels next to each other.
+		std::vector<uint64_t> keys(count);
+		parallelFor(0, count, FILTER_GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const glm::vec3& p = points[i];
+				if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+				{
+					keys[i] = NO_VOXEL;
+					continue;
+				}
+				keys[i] = mortonCode(static_cast<uint64_t>((p.x - min.x) / voxelSize), static_cast<uint64_t>((p.y - min.y) / voxelSize),
+					static_cast<uint64_t>((p.z - min.z) / voxelSize));
+			}
+		});
+		std::vector<size_t> order;
+		radixSortOrder(keys.data(), count, order);
+
+		// Voxel v holds the sorted points [voxels[v], voxels[v + 1]).
+		std::vector<size_t> voxels;
+		size_t sorted = 0;
+		for (; sorted < count && keys[order[sorted]] != NO_VOXEL; ++sorted)
+		{
+			if (sorted == 0 || keys[order[sorted]] != keys[order[sorted - 1]])
+				voxels.push_back(sorted);
+		}
+		const size_t voxelCount = voxels.size();
+		voxels.push_back(sorted);
+
+		output.resize(voxelCount);
+		parallelFor(0, voxelCount, FILTER_GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; ++v)
+			{
+				if (mode == VoxelMode::First)
+				{
+					output[v] = points[order[voxels[v]]];
+					continue;
+				}
+
+				// Sum relative to the first point, so coordinates far from the origin keep their precision.
+				const glm::vec3& first = points[order[voxels[v]]];
+				double sum[3] = { 0, 0, 0 };
+				for (size_t i = voxels[v]; i < voxels[v + 1]; ++i)
+				{
+					for (int c = 0; c < 3; ++c)
+						sum[c] += points[order[i]][c] - first[c];
+				}
+				const double n = static_cast<double>(voxels[v + 1] - voxels[v]);
+				output[v] = glm::vec3(first.x + static_cast<float>(sum[0] / n), first.y + static_cast<float>(sum[1] / n),
+					first.z + static_cast<float>(sum[2] / n));
+			}
+		});
+		return true;
+	}
+
+	bool removeOutliers(const glm::vec3* points, size_t count, unsigned int neighbours, float sigma, std::vector<glm::vec3>& output)
+	{
+		if (neighbours == 0)
+		{
+			std::cerr << "ERROR! Outlier removal needs at least one neighbour." << std::endl;
+			return false;
+		}
+		KdTree tree;
+		if (!tree.build(points, count))
+			return false;
+
+		// Queries close to each other walk the same part of the tree, so they are answered in Morton order.
+		std::vector<size_t> order;
+		std::vector<glm::vec3> sorted;
+		const glm::vec3* queries = points;
+		if (mortonOrder(points, count, order))
+		{
+			sorted.resize(count);
+			parallelFor(0, count, FILTER_GRAIN, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					sorted[i] = points[order[i]];
+			});
+			queries = sorted.data();
+		}
+
+		// Every point finds itself first, so one more neighbour is looked up and the first one skipped. Non-finite
+		// points get a NaN distance, which no threshold keeps.
+		const size_t k = static_cast<size_t>(neighbours) + 1;
+		std::vector<float> meanDistances(count);
+		std::vector<uint32_t> indices(OUTLIER_BLOCK * k);
+		std::vector<float> squaredDistances(OUTLIER_BLOCK * k);
+		for (size_t block = 0; block < count; block += OUTLIER_BLOCK)
+		{
+			const size_t blockSize = std::min(OUTLIER_BLOCK, count - block);
+			tree.nearest(queries + block, blockSize, k, indices.data(), squaredDistances.data());
+			parallelFor(0, blockSize, FILTER_GRAIN / 16, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					const glm::vec3& p = queries[block + i];
+					float& meanDistance = meanDistances[order.empty() ? block + i : order[block + i]];
+					if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+					{
+						meanDistance = std::numeric_limits<float>::quiet_NaN();
+						continue;
+					}
+					float distance = 0;
+					size_t found = 0;
+					for (size_t j = 1; j < k && indices[i * k + j] != KdTree::NO_POINT; ++j, ++found)
+						distance += std::sqrt(squaredDistances[i * k + j]);
+					meanDistance = found ? distance / found : 0.0f;
+				}
+			});
+		}
+
+		double sum = 0, squaredSum = 0;
+		size_t measured = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (meanDistances[i] != meanDistances[i])
+				continue;
+			sum += meanDistances[i];
+			squaredSum += static_cast<double>(meanDistances[i]) * meanDistances[i];
+			++measured;
+		}
+
+		const double mean = measured ? sum / measured : 0.0;
+		const double variance = measured ? std::max(0.0, squaredSum / measured - mean * mean) : 0.0;
+		const float threshold = static_cast<float>(mean + sigma * std::sqrt(variance));
+
+		output.clear();
+		output.reserve(measured);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (meanDistances[i] <= threshold)
+				output.push_back(points[i]);
+		}
+		return true;
+	}
+}
@@ -0,0 +1,369 @@
+#include "PointStatistics.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "CpuFeatures.h"
+#include "Parallel.h"
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Fewest values a worker reduces, so small inputs stay on the calling thread.
+		const size_t STATISTICS_GRAIN = 1u << 18;
+
+		// Vector steps summed in float before the partial sums are flushed to double.
+		const size_t BLOCK_STEPS = 256;
+
+		// Widest register holds 16 floats, and interleaved xyz needs three of them per step.
+		const size_t MAX_LANES = 3 * 16;
+
+		// Sums are taken of value - shift, with the shift set to the first value of each component, so the
+		// variance does not cancel away for coordinates far from the origin.
+		struct Accumulator
+		{
+			float min[3];
+			float max[3];
+			double sum[3] = { 0, 0, 0 };
+			double squares[3] = { 0, 0, 0 };
+
+			Accumulator()
+			{
+				std::fill(min, min + 3, std::numeric_limits<float>::infinity());
+				std::fill(max, max + 3, -std::numeric_limits<float>::infinity());
+			}
+		};
+
+		// Lane L of the registers of one step holds component L % P, because a step spans a multiple of P floats.
+		template<int P>
+		void FoldLanes(const float* lo, const float* hi, const double* sums, const double* squares, size_t lanes, Accumulator& acc)
+		{
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const size_t c = lane % P;
+				acc.min[c] = std::min(acc.min[c], lo[lane]);
+				acc.max[c] = std::max(acc.max[c], hi[lane]);
+				acc.sum[c] += sums[lane];
+				acc.squares[c] += squares[lane];
+			}
+		}
+
+		template<int P>
+		void AccumulateScalar(const float* values, size_t floats, const float* shift, Accumulator& acc)
+		{
+			for (size_t i = 0; i < floats; ++i)
+			{
+				const size_t c = i % P;
+				const float v = values[i];
+				acc.min[c] = std::min(acc.min[c], v);
+				acc.max[c] = std::max(acc.max[c], v);
+				const double d = static_cast<double>(v) - shift[c];
+				acc.sum[c] += d;
+				acc.squares[c] += d * d;
+			}
+		}
+
+#ifdef CPUFEATURES_X86
+		// Each kernel reduces whole steps of P registers and returns how many floats it consumed.
+		typedef size_t (*AccumulateBlocks)(const float* values, size_t floats, const float* shiftLanes, Accumulator& acc);
+
+		template<int P>
+		size_t AccumulateSse2(const float* values, size_t floats, const float* shiftLanes, Accumulator& acc)
+		{
+			const size_t W = 4, STEP = P * W, steps = floats / STEP;
+			if (steps == 0)
+				return 0;
+
+			__m128 lo[P], hi[P], shift[P];
+			double sums[P * W] = {}, squares[P * W] = {};
+			for (int r = 0; r < P; ++r)
+			{
+				lo[r] = _mm_set1_ps(std::numeric_limits<float>::infinity());
+				hi[r] = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+				shift[r] = _mm_loadu_ps(shiftLanes + r * W);
+			}
+
+			const float* p = values;
+			for (size_t done = 0; done < steps;)
+			{
+				const size_t block = std::min(steps - done, BLOCK_STEPS);
+				__m128 sum[P], square[P];
+				for (int r = 0; r < P; ++r)
+					sum[r] = square[r] = _mm_setzero_ps();
+
+				for (size_t s = 0; s < block; ++s, p += STEP)
+				{
+					for (int r = 0; r < P; ++r)
+					{
+						__m128 v = _mm_loadu_ps(p + r * W);
+						lo[r] = _mm_min_ps(lo[r], v);
+						hi[r] = _mm_max_ps(hi[r], v);
+						__m128 d = _mm_sub_ps(v, shift[r]);
+						sum[r] = _mm_add_ps(sum[r], d);
+						square[r] = _mm_add_ps(square[r], _mm_mul_ps(d, d));
+					}
+				}
+
+				float lanes[W], squareLanes[W];
+				for (int r = 0; r < P; ++r)
+				{
+					_mm_storeu_ps(lanes, sum[r]);
+					_mm_storeu_ps(squareLanes, square[r]);
+					for (size_t k = 0; k < W; ++k)
+					{
+						sums[r * W + k] += lanes[k];
+						squares[r * W + k] += squareLanes[k];
+					}
+				}
+				done += block;
+			}
+
+			float loLanes[P * W], hiLanes[P * W];
+			for (int r = 0; r < P; ++r)
+			{
+				_mm_storeu_ps(loLanes + r * W, lo[r]);
+				_mm_storeu_ps(hiLanes + r * W, hi[r]);
+			}
+			FoldLanes<P>(loLanes, hiLanes, sums, squares, P * W, acc);
+			return steps * STEP;
+		}
+
+		template<int P>
+		CPUFEATURES_TARGET_AVX2 size_t AccumulateAvx2(const float* values, size_t floats, const float* shiftLanes, Accumulator& acc)
+		{
+			const size_t W = 8, STEP = P * W, steps = floats / STEP;
+			if (steps == 0)
+				return 0;
+
+			__m256 lo[P], hi[P], shift[P];
+			double sums[P * W] = {}, squares[P * W] = {};
+			for (int r = 0; r < P; ++r)
+			{
+				lo[r] = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+				hi[r] = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+				shift[r] = _mm256_loadu_ps(shiftLanes + r * W);
+			}
+
+			const float* p = values;
+			for (size_t done = 0; done < steps;)
+			{
+				const size_t block = std::min(steps - done, BLOCK_STEPS);
+				__m256 sum[P], square[P];
+				for (int r = 0; r < P; ++r)
+					sum[r] = square[r] = _mm256_setzero_ps();
+
+				for (size_t s = 0; s < block; ++s, p += STEP)
+				{
+					for (int r = 0; r < P; ++r)
+					{
+						__m256 v = _mm256_loadu_ps(p + r * W);
+						lo[r] = _mm256_min_ps(lo[r], v);
+						hi[r] = _mm256_max_ps(hi[r], v);
+						__m256 d = _mm256_sub_ps(v, shift[r]);
+						sum[r] = _mm256_add_ps(sum[r], d);
+						square[r] = _mm256_add_ps(square[r], _mm256_mul_ps(d, d));
+					}
+				}
+
+				float lanes[W], squareLanes[W];
+				for (int r = 0; r < P; ++r)
+				{
+					_mm256_storeu_ps(lanes, sum[r]);
+					_mm256_storeu_ps(squareLanes, square[r]);
+					for (size_t k = 0; k < W; ++k)
+					{
+						sums[r * W + k] += lanes[k];
+						squares[r * W + k] += squareLanes[k];
+					}
+				}
+				done += block;
+			}
+
+			float loLanes[P * W], hiLanes[P * W];
+			for (int r = 0; r < P; ++r)
+			{
+				_mm256_storeu_ps(loLanes + r * W, lo[r]);
+				_mm256_storeu_ps(hiLanes + r * W, hi[r]);
+			}
+			FoldLanes<P>(loLanes, hiLanes, sums, squares, P * W, acc);
+			return steps * STEP;
+		}
+
+		template<int P>
+		CPUFEATURES_TARGET_AVX512 size_t AccumulateAvx512(const float* values, size_t floats, const float* shiftLanes, Accumulator& acc)
+		{
+			const size_t W = 16, STEP = P * W, steps = floats / STEP;
+			if (steps == 0)
+				return 0;
+
+			__m512 lo[P], hi[P], shift[P];
+			double sums[P * W] = {}, squares[P * W] = {};
+			for (int r = 0; r < P; ++r)
+			{
+				lo[r] = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+				hi[r] = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+				shift[r] = _mm512_loadu_ps(shiftLanes + r * W);
+			}
+
+			const float* p = values;
+			for (size_t done = 0; done < steps;)
+			{
+				const size_t block = std::min(steps - done, BLOCK_STEPS);
+				__m512 sum[P], square[P];
+				for (int r = 0; r < P; ++r)
+					sum[r] = square[r] = _mm512_setzero_ps();
+
+				for (size_t s = 0; s < block; ++s, p += STEP)
+				{
+					for (int r = 0; r < P; ++r)
+					{
+						__m512 v = _mm512_loadu_ps(p + r * W);
+						lo[r] = _mm512_min_ps(lo[r], v);
+						hi[r] = _mm512_max_ps(hi[r], v);
+						__m512 d = _mm512_sub_ps(v, shift[r]);
+						sum[r] = _mm512_add_ps(sum[r], d);
+						square[r] = _mm512_add_ps(square[r], _mm512_mul_ps(d, d));
+					}
+				}
+
+				float lanes[W], squareLanes[W];
+				for (int r = 0; r < P; ++r)
+				{
+					_mm512_storeu_ps(lanes, sum[r]);
+					_mm512_storeu_ps(squareLanes, square[r]);
+					for (size_t k = 0; k < W; ++k)
+					{
+						sums[r * W + k] += lanes[k];
+						squares[r * W + k] += squareLanes[k];
+					}
+				}
+				done += block;
+			}
+
+			float loLanes[P * W], hiLanes[P * W];
+			for (int r = 0; r < P; ++r)
+			{
+				_mm512_storeu_ps(loLanes + r * W, lo[r]);
+				_mm512_storeu_ps(hiLanes + r * W, hi[r]);
+			}
+			FoldLanes<P>(loLanes, hiLanes, sums, squares, P * W, acc);
+			return steps * STEP;
+		}
+
+#endif
+
+		template<int P>
+		void Accumulate(const float* values, size_t floats, const float* shift, Accumulator& acc)
+		{
+			float shiftLanes[MAX_LANES];
+			for (size_t lane = 0; lane < MAX_LANES; ++lane)
+				shiftLanes[lane] = shift[lane % P];
+
+			size_t done = 0;
+#ifdef CPUFEATURES_X86
+			AccumulateBlocks accumulate = selectKernel<AccumulateBlocks>(nullptr, AccumulateSse2<P>, AccumulateAvx2<P>, AccumulateAvx512<P>);
+			if (accumulate)
+				done = accumulate(values, floats, shiftLanes, acc);
+#endif
+			AccumulateScalar<P>(values + done, floats - done, shift, acc);
+		}
+
+		// Reduces 'elements' groups of P interleaved floats into one ColumnStatistics per component.
+		template<int P>
+		void Reduce(const float* values, size_t elements, ColumnStatistics* out)
+		{
+			if (elements == 0)
+			{
+				for (int c = 0; c < P; ++c)
+					out[c] = ColumnStatistics();
+				return;
+			}
+
+			float shift[P];
+			for (int c = 0; c < P; ++c)
+				shift[c] = values[c];
+
+			// Every slice uses the same shift, so the partial sums simply add up.
+			const size_t slices = std::max<size_t>(1, std::min<size_t>(workerCount(), elements / STATISTICS_GRAIN));
+			std::vector<Accumulator> partials(slices);
+			parallelFor(0, slices, 1, [&](size_t first, size_t last)
+			{
+				for (size_t s = first; s < last; ++s)
+				{
+					const size_t begin = elements * s / slices, end = elements * (s + 1) / slices;
+					Accumulate<P>(values + begin * P, (end - begin) * P, shift, partials[s]);
+				}
+			});
+
+			Accumulator total;
+			for (const Accumulator& partial : partials)
+			{
+				for (int c = 0; c < P; ++c)
+				{
+					total.min[c] = std::min(total.min[c], partial.min[c]);
+					total.max[c] = std::max(total.max[c], partial.max[c]);
+					total.sum[c] += partial.sum[c];
+					total.squares[c] += partial.squares[c];
+				}
+			}
+
+			for (int c = 0; c < P; ++c)
+			{
+				const double shiftedMean = total.sum[c] / elements;
+				out[c].count = elements;
+				out[c].min = total.min[c];
+				out[c].max = total.max[c];
+				out[c].mean = shift[c] + shiftedMean;
+				out[c].variance = std::max(0.0, total.squares[c] / elements - shiftedMean * shiftedMean);
+			}
+		}
+	}
+
+	void ColumnStatistics::merge(const ColumnStatistics& other)
+	{
+		if (other.count == 0)
+			return;
+		if (count == 0)
+		{
+			*this = other;
+			return;
+		}
+
+		// Chan et al.'s pairwise update of the mean and the sum of squared deviations.
+		const double n = static_cast<double>(count), m = static_cast<double>(other.count), total = n + m;
+		const double delta = other.mean - mean;
+		const double deviations = variance * n + other.variance * m + delta * delta * n * m / total;
+		mean += delta * m / total;
+		variance = deviations / total;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+		count += other.count;
+	}
+
+	void PointStatistics::merge(const PointStatistics& other)
+	{
+		x.merge(other.x);
+		y.merge(other.y);
+		z.merge(other.z);
+	}
+
+	ColumnStatistics computeColumnStatistics(const float* values, size_t count)
+	{
+		ColumnStatistics statistics;
+		Reduce<1>(values, count, &statistics);
+		return statistics;
+	}
+
+	PointStatistics computeStatistics(const glm::vec3* points, size_t count)
+	{
+		static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must be three packed floats");
+
+		ColumnStatistics axes[3];
+		Reduce<3>(reinterpret_cast<const float*>(points), count, axes);
+		PointStatistics statistics;
+		statistics.x = axes[0];
+		statistics.y = axes[1];
+		statistics.z = axes[2];
+		return statistics;
+	}
+}
@@ -1,6 +1,13 @@
 #include "PointcloudVisualizer.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <gl/glext.h>
+#include "MeshBuilder.h"
 
 namespace PointcloudVisualizer 
 {
@@ -215,32 +222,204 @@ void APIENTRY PointcloudVisualizer::debugMessageCallback(
 	printf("\n\n");
 }
 
-void PointcloudVisualizer::PointcloudVisualizer::addData(cv::Mat& cloud) {
+namespace
+{
 	// Convert to single-channel, grayscale image if necessary.
-	if (cloud.type() != CV_32F) {
-		if (cloud.channels() > 1) {
-			cv::cvtColor(cloud, cloud, cv::COLOR_BGR2GRAY);
-		}
+	void ConvertDepthImage(cv::Mat& cloud)
+	{
 		if (cloud.type() != CV_32F) {
-			cloud.convertTo(cloud, CV_32F);
+			if (cloud.channels() > 1) {
+				cv::cvtColor(cloud, cloud, cv::COLOR_BGR2GRAY);
+			}
+			if (cloud.type() != CV_32F) {
+				cloud.convertTo(cloud, CV_32F);
+			}
 		}
 	}
+}
 
-	// Add object to data array.
+void PointcloudVisualizer::PointcloudVisualizer::addData(cv::Mat& cloud) {
+	ConvertDepthImage(cloud);
+
+	// Add object to data array. The mesh shares the pixels with 'cloud'.
 	CloudMesh mesh(cloud);
-	this->meshes.push_back(mesh);
+	mesh.residency = residency;
+	this->meshes.push_back(std::move(mesh));
 }
 
 void PointcloudVisualizer::PointcloudVisualizer::addData(std::vector<glm::vec3>& cloud) 
 {
 	CloudMesh mesh(cloud);
-	this->meshes.push_back(mesh);
+	mesh.residency = residency;
+	this->meshes.push_back(std::move(mesh));
 }
 
 void PointcloudVisualizer::PointcloudVisualizer::addData(std::vector<std::vector<float>>& cloud) 
 {
 	CloudMesh mesh(cloud);
-	this->meshes.push_back(mesh);
+	mesh.residency = residency;
+	this->meshes.push_back(std::move(mesh));
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::addData(cv::Mat&& cloud)
+{
+	ConvertDepthImage(cloud);
+	this->meshes.emplace_back(std::move(cloud));
+	this->meshes.back().residency = residency;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::addData(std::vector<std::vector<float>>&& cloud)
+{
+	this->meshes.emplace_back(std::move(cloud));
+	this->meshes.back().residency = residency;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::addData(std::vector<glm::vec3>&& cloud)
+{
+	this->meshes.emplace_back(std::move(cloud));
+	this->meshes.back().residency = residency;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::addData(std::shared_ptr<const std::vector<glm::vec3>> cloud)
+{
+	if (!cloud) { return; }
+	const glm::vec3* points = cloud->data();
+	const size_t count = cloud->size();
+	this->meshes.emplace_back(points, count, std::move(cloud));
+	this->meshes.back().residency = residency;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::addData(const glm::vec3* points, size_t count)
+{
+	this->meshes.emplace_back(points, count);
+	this->meshes.back().residency = residency;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::addData(const float* depth, int rows, int columns, size_t stride)
+{
+	// A Mat header over the caller's memory; nothing is copied and the mesh only ever reads it.
+	this->meshes.emplace_back(cv::Mat(rows, columns, CV_32F, const_cast<float*>(depth), stride));
+	this->meshes.back().residency = residency;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::loadAsync(const std::string& filename, bool useCache, glm::vec3 position)
+{
+	loadPosition = position;
+	loadingMesh = -1;
+	loadActive = true;
+	firstPixelPending = true;
+	loadStartTime = glfwGetTime();
+
+	LoadOptions options;
+	options.useCache = useCache;
+	options.spatialSort = spatialSort;
+	options.voxelSize = voxelSize;
+	options.voxelMode = voxelMode;
+	options.outlierSigma = outlierSigma;
+	options.outlierNeighbours = outlierNeighbours;
+	loader.start(filename, options);
+}
+
+PointcloudVisualizer::OctreeCloud* PointcloudVisualizer::PointcloudVisualizer::addOctree(const std::string& filename, glm::vec3 position)
+{
+	std::unique_ptr<OctreeCloud> octree(new OctreeCloud());
+	if (!octree->open(filename)) {
+		std::cerr << "ERROR! No current octree for " << filename << ", it has to be built first." << std::endl;
+		return nullptr;
+	}
+	octree->position = position;
+	std::cout << "Opened octree of " << octree->tree().pointCount() << " points in " << octree->tree().nodeCount() << " nodes." << std::endl;
+	octrees.push_back(std::move(octree));
+	return octrees.back().get();
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::cancelLoading()
+{
+	if (!loadActive)
+		return;
+
+	loader.cancel();
+	std::cout << "Loading cancelled." << std::endl;
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::PollLoader()
+{
+	if (!loadActive)
+		return;
+
+	// Read the state before taking batches, so nothing pushed before the worker finished is missed.
+	bool finished = !loader.isLoading();
+	std::vector<CloudLoader::Batch> batches;
+	loader.takeBatches(batches);
+
+	for (CloudLoader::Batch& batch : batches)
+	{
+		if (!batch.image.empty())
+		{
+			addData(std::move(batch.image));
+			meshes.back().position = loadPosition;
+		}
+		else if (loadingMesh < 0)
+		{
+			addData(std::move(batch.points));
+			loadingMesh = static_cast<int>(meshes.size()) - 1;
+			meshes.back().position = loadPosition;
+		}
+		else
+		{
+			std::vector<glm::vec3>& cloud = meshes[loadingMesh].dataGLM;
+			cloud.insert(cloud.end(), batch.points.begin(), batch.points.end());
+			meshes[loadingMesh].dataAppended();
+		}
+	}
+
+	double now = glfwGetTime();
+	if (finished)
+	{
+		glfwSetWindowTitle(window, "Pointcloud Visualizer");
+		loadActive = false;
+		loadingMesh = -1;
+	}
+	else if (now - lastTitleUpdate > 0.2)
+	{
+		std::string title = "Pointcloud Visualizer - loading " + std::to_string(static_cast<int>(loader.progress() * 100.0f)) + "% (C to cancel)";
+		glfwSetWindowTitle(window, title.c_str());
+		lastTitleUpdate = now;
+	}
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::EnforceMemoryBudget()
+{
+	std::vector<MemoryBudget::Entry> entries(meshes.size());
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		CloudMesh& mesh = meshes[i];
+		const bool loading = loadActive && static_cast<int>(i) == loadingMesh;
+
+		// Residency policy: drop the host copy as soon as all of the mesh is on the GPU.
+		if (!loading && !mesh.streaming && mesh.residency != Residency::Keep && mesh.hasHostData() && mesh.isUploaded())
+			mesh.releaseHostData(mesh.residency == Residency::Spill);
+
+		entries[i].hostBytes = mesh.hostBytes();
+		entries[i].gpuBytes = mesh.gpuBytes();
+		entries[i].lastDrawn = mesh.lastDrawnFrame;
+		entries[i].hostEvictable = !loading && !mesh.streaming && mesh.hasHostData() && mesh.isUploaded();
+		entries[i].gpuEvictable = !loading && (mesh.hasHostData() || mesh.isSpilled());
+	}
+
+	std::vector<size_t> hostEvictions, gpuEvictions;
+	bool fits = memoryBudget.plan(entries, frameIndex, hostEvictions, gpuEvictions);
+	for (size_t i : hostEvictions)
+		meshes[i].releaseHostData(true);
+	for (size_t i : gpuEvictions)
+		meshes[i].clear();
+
+	if (!fits && !budgetWarned)
+	{
+		std::cerr << "WARNING: The meshes drawn need " << (memoryBudget.hostBytes() >> 20) << " MiB of host and "
+			<< (memoryBudget.gpuBytes() >> 20) << " MiB of GPU memory, more than the memory budget allows." << std::endl;
+		budgetWarned = true;
+	}
 }
 
 void PointcloudVisualizer::cursorCallback(GLFWwindow* window, double xpos, double ypos)
@@ -273,8 +452,12 @@ void PointcloudVisualizer::PointcloudVisualizer::shutdown()
 
 void PointcloudVisualizer::PointcloudVisualizer::clear() 
 {
-	for (int i = 0; i < meshes.size(); ++i)
+	for (int i = 0; i < meshes.size(); ++i) {
 		meshes[i].clear();	
+		meshes[i].discardSpill();
+	}
+	for (const std::unique_ptr<OctreeCloud>& octree : octrees)
+		octree->release();
 
 	if (this->axisVAO)
 		glDeleteVertexArrays(1, &axisVAO);
@@ -286,6 +469,9 @@ void PointcloudVisualizer::PointcloudVisualizer::clear()
 
 void PointcloudVisualizer::PointcloudVisualizer::initialize(int w, int h) 
 {
+	jobs.reset(new JobSystem(workerThreads));
+	jobs->makeCurrent();
+
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -338,7 +524,7 @@ void PointcloudVisualizer::PointcloudVisualizer::initialize(int w, int h)
 	// Setup shader
 	shader = new Shader("shader.vs", "shader.fs");
 	shader->use();
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
 	shader->setMat4("projection", projection);
 	shader->setInt("texture1", 0);
 
@@ -387,6 +573,8 @@ void PointcloudVisualizer::PointcloudVisualizer::processInput(GLFWwindow* window
 		glfwSetWindowShouldClose(window, true);
 	else if (glfwGetKey(window, GLFW_KEY_HOME) == GLFW_PRESS)
 		camera.Position = glm::vec3(0);
+	else if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
+		cancelLoading();
 	else if (glfwGetKey(window, GLFW_KEY_END) == GLFW_PRESS && keyTimer == 0) {//screenshot button
 		saveFramebufferToFile(0);
 		keyTimer = 50;
@@ -409,277 +597,635 @@ void PointcloudVisualizer::PointcloudVisualizer::processInput(GLFWwindow* window
 	}
 }
 
-void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadVAO_CV() {
-	// Check if this pointcloud mesh has been loaded, and if so return.
-	if (dataCV.empty() || VAO || VBO || VBO2) { return; }
+namespace
+{
+	const size_t INDICES_PER_CELL = 6;
 
-	std::vector<glm::vec3> transVecs;
-	std::vector<glm::vec3> normals;
+	// Units per culling chunk: small enough to skip most of a cloud seen up close, large enough that testing
+	// and submitting the chunks costs little next to drawing them.
+	const size_t CHUNK_UNITS = 1u << 14;
 
-	x_min = y_min = z_min = 99999999;
-	x_max = y_max = z_max = -99999999;
+	// Spill files hold this header followed by rows * columns floats, row by row.
+	struct SpillHeader
+	{
+		char magic[8];
+		uint32_t datatype;
+		uint32_t reserved;
+		uint64_t rows;
+		uint64_t columns;
+	};
 
-	// Save all point coordinates on the GPU.
-	for (int i = 0; i < dataCV.rows - 1; ++i) {
-		for (int j = 0; j < dataCV.cols - 1; ++j) {
+	const char SPILL_MAGIC[8] = { 'P', 'C', 'V', 'S', 'P', 'I', 'L', 'L' };
+	std::atomic<unsigned int> spillFiles(0);
 
-			if (j < x_min) { x_min = j; }
-			if (j > x_max) { x_max = j; }
-			if (i < y_min) { y_min = i; }
-			if (i > y_max) { y_max = i; }
+	// Statistics of the indices 0..count-1, each repeated 'repeats' times.
+	PointcloudVisualizer::ColumnStatistics IndexStatistics(size_t count, size_t repeats)
+	{
+		PointcloudVisualizer::ColumnStatistics statistics;
+		if (count == 0 || repeats == 0) { return statistics; }
+		statistics.count = count * repeats;
+		statistics.min = 0;
+		statistics.max = static_cast<float>(count - 1);
+		statistics.mean = (count - 1) / 2.0;
+		statistics.variance = (static_cast<double>(count) * count - 1) / 12.0;
+		return statistics;
+	}
+}
 
-			float d1 = dataCV.at<float>(i, j);
-			float d2 = dataCV.at<float>(i, j + 1);
-			float d3 = dataCV.at<float>(i + 1, j);
-			float d4 = dataCV.at<float>(i + 1, j + 1);
-			std::vector<float> vec{ d1, d2, d3, d4 };
-			float dmin = *std::min_element(vec.begin(), vec.end());
-			float dmax = *std::max_element(vec.begin(), vec.end());
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::buildIndices(size_t begin, size_t end) {
+	const size_t columns = gridColumns();
+	stagingIndices.resize((end - begin) * INDICES_PER_CELL);
+	unsigned int* index = stagingIndices.data();
+	for (size_t c = begin; c < end; ++c, index += INDICES_PER_CELL) {
+		unsigned int a = static_cast<unsigned int>((c / (columns - 1)) * columns + c % (columns - 1));
+		unsigned int b = a + 1;
+		unsigned int below = a + static_cast<unsigned int>(columns);
+
+		index[0] = a;
+		index[1] = b;
+		index[2] = below;
+
+		index[3] = b;
+		index[4] = below + 1;
+		index[5] = below;
+	}
+}
 
-			if (dmin < z_min) { z_min = dmin; }
-			if (dmax > z_max) { z_max = dmax; }
+size_t PointcloudVisualizer::PointcloudVisualizer::CloudMesh::gridRows() const {
+	if (datatype == DATA_TYPE::CV) { return CvAccess(dataCV).rows(); }
+	if (datatype == DATA_TYPE::STL) { return RowMajorAccess(dataSTL).rows(); }
+	return 0;
+}
 
-			transVecs.push_back(glm::vec3(i, j, d1));
-			transVecs.push_back(glm::vec3(i, j + 1, d2));
-			transVecs.push_back(glm::vec3(i + 1, j, d3));
+size_t PointcloudVisualizer::PointcloudVisualizer::CloudMesh::gridColumns() const {
+	if (datatype == DATA_TYPE::CV) { return CvAccess(dataCV).columns(); }
+	if (datatype == DATA_TYPE::STL) { return RowMajorAccess(dataSTL).columns(); }
+	return 0;
+}
 
-			transVecs.push_back(glm::vec3(i, j + 1, d2));
-			transVecs.push_back(glm::vec3(i + 1, j + 1, d4));
-			transVecs.push_back(glm::vec3(i + 1, j, d3));
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::updateStatistics() {
+	if (datatype == DATA_TYPE::GLM) {
+		// Point lists only grow, so only the new tail is reduced.
+		if (pointCount() > statisticsPoints) {
+			pointStatistics.merge(computeStatistics(points() + statisticsPoints, pointCount() - statisticsPoints));
+			statisticsPoints = pointCount();
 		}
+		return;
 	}
 
-	// Calculate normals.
-	for (int i = 0; i < transVecs.size(); i += 3) {
-		glm::vec3 normal =
-			glm::normalize(
-				glm::cross(
-					glm::vec3(transVecs[i + 1]) - glm::vec3(transVecs[i]),
-					glm::vec3(transVecs[i + 2]) - glm::vec3(transVecs[i])
-				)
-			);
-		normals.push_back(normal);
-	}
-
-	unsigned int VAO_, VBO_, VBO2_, drawCount_;
-	VAO_ = VBO_ = VBO2_ = drawCount_ = 0;
-
-	// Load into VAO
-	glBindVertexArray(VAO_);
-	glGenVertexArrays(1, &VAO_);
-	glBindVertexArray(VAO_);
+	const size_t rows = gridRows(), columns = gridColumns();
+	if (statisticsPoints == rows * columns) { return; }
 
-	// aPos
-	glGenBuffers(1, &VBO_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-	glBufferData(GL_ARRAY_BUFFER, transVecs.size() * sizeof(glm::vec3), &transVecs[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glEnableVertexAttribArray(0);
+	// Grid vertices are (row, column, depth): x and y are evenly spaced indices, z are the depth samples.
+	pointStatistics = PointStatistics();
+	pointStatistics.x = IndexStatistics(rows, columns);
+	pointStatistics.y = IndexStatistics(columns, rows);
+	if (datatype == DATA_TYPE::CV && dataCV.isContinuous()) {
+		pointStatistics.z = computeColumnStatistics(dataCV.ptr<float>(0), rows * columns);
+	}
+	else {
+		for (size_t i = 0; i < rows; ++i) {
+			const float* row = datatype == DATA_TYPE::CV ? dataCV.ptr<float>(static_cast<int>(i)) : dataSTL[i].data();
+			pointStatistics.z.merge(computeColumnStatistics(row, columns));
+		}
+	}
+	statisticsPoints = rows * columns;
+}
 
-	// aNormal
-	glGenBuffers(1, &VBO2_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO2_);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glEnableVertexAttribArray(1);
+size_t PointcloudVisualizer::PointcloudVisualizer::CloudMesh::unitCount() const {
+	if (isGrid()) { return gridRows() * gridColumns(); }
+	return PointListSource(points(), pointCount()).units();
+}
 
-	VAO = VAO_;
-	VBO = VBO_;
-	//cl.VBO2 = VBO2_;
-	drawCount = transVecs.size();
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::reserveUnits(size_t units) {
+	if (units <= capacityUnits) { return; }
+
+	// Grow geometrically, so a mesh that keeps receiving points is only copied O(log n) times, and only on the GPU.
+	const size_t capacity = std::max(units, capacityUnits * 2);
+	const size_t perUnit[2] = { verticesPerUnit(), normalsPerUnit() };
+	unsigned int previous[2] = { VBO, VBO2 };
+	unsigned int buffers[2] = { 0, 0 };
+
+	if (!VAO) { glGenVertexArrays(1, &VAO); }
+	glBindVertexArray(VAO);
+	glGenBuffers(2, buffers);
+
+	// Attribute 0 is aPos, attribute 1 is aNormal.
+	for (int b = 0; b < 2; ++b) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[b]);
+		glBufferData(GL_ARRAY_BUFFER, capacity * perUnit[b] * sizeof(glm::vec3), NULL, GL_STATIC_DRAW);
+		if (previous[b]) {
+			if (uploadedUnits) {
+				glBindBuffer(GL_COPY_READ_BUFFER, previous[b]);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, 0, uploadedUnits * perUnit[b] * sizeof(glm::vec3));
+			}
+			glDeleteBuffers(1, &previous[b]);
+		}
+		glVertexAttribPointer(b, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glEnableVertexAttribArray(b);
+	}
 
-	transVecs.clear();
-	//normals.clear();
+	VBO = buffers[0];
+	VBO2 = buffers[1];
+	capacityUnits = capacity;
 
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
 }
 
-void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadVAO_GLM() {
-	// Check if this pointcloud mesh has been loaded, and if so return.
-	if (dataGLM.size() == 0 || VAO || VBO || VBO2) { return; }
-
-	std::vector<glm::vec3> transVecs;
-	std::vector<glm::vec3> normals;
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadVAO(size_t& budgetBytes) {
+	// Released data stays on the GPU as it is. Spilled data evicted from the GPU is read back to upload it again.
+	if (!hostResident && (uploadedUnits > 0 || !restoreHostData())) { return; }
 
-	x_min = y_min = z_min = 99999999;
-	x_max = y_max = z_max = -99999999;
+	// Streaming meshes always show the latest data as a whole, whatever is left of the budget.
+	if (streaming) {
+		loadStreaming(budgetBytes);
+		updateChunks();
+		loadIndices(budgetBytes);
+		return;
+	}
 
-	// Save all point coordinates on the GPU.
-	for (int i = 0; i < dataGLM.size()-3; ++i) {
+	// Check if the frame's upload budget is spent.
+	if (budgetBytes == 0) { return; }
 
-			if (dataGLM[i].x < x_min) { x_min = dataGLM[i].x; }
-			if (dataGLM[i].x > x_max) { x_max = dataGLM[i].x; }
-			if (dataGLM[i].y < y_min) { y_min = dataGLM[i].y; }
-			if (dataGLM[i].y > y_max) { y_max = dataGLM[i].y; }
+	// A mesh that stopped streaming goes back to static buffers, uploaded from the start.
+	if (stream.buffer()) {
+		stream.release();
+		uploadedUnits = capacityUnits = 0;
+	}
 
-			float d1 = dataGLM[i].z;
-			float d2 = dataGLM[i + 1].z;
-			float d3 = dataGLM[i + 2].z;
-			float d4 = dataGLM[i + 3].z;
-			std::vector<float> vec{ d1, d2, d3, d4 };
-			float dmin = *std::min_element(vec.begin(), vec.end());
-			float dmax = *std::max_element(vec.begin(), vec.end());
+	const size_t units = unitCount();
+	if (units > uploadedUnits) {
+		updateStatistics();
+		reserveUnits(units);
+
+		// Build the next range of units, always at least one so a tiny budget still makes progress.
+		const size_t bytesPerUnit = (verticesPerUnit() + normalsPerUnit()) * sizeof(glm::vec3);
+		const size_t count = std::min(units - uploadedUnits, std::max<size_t>(budgetBytes / bytesPerUnit, 1));
+		switch (datatype) {
+		case DATA_TYPE::CV:
+			buildMesh(GridSource<CvAccess>(CvAccess(dataCV)), uploadedUnits, uploadedUnits + count, stagingVertices, stagingNormals);
+			break;
+		case DATA_TYPE::STL:
+			buildMesh(GridSource<RowMajorAccess>(RowMajorAccess(dataSTL)), uploadedUnits, uploadedUnits + count, stagingVertices, stagingNormals);
+			break;
+		case DATA_TYPE::GLM:
+			buildMesh(PointListSource(points(), pointCount()), uploadedUnits, uploadedUnits + count, stagingVertices, stagingNormals);
+			break;
+		}
 
-			if (dmin < z_min) { z_min = dmin; }
-			if (dmax > z_max) { z_max = dmax; }
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferSubData(GL_ARRAY_BUFFER, uploadedUnits * verticesPerUnit() * sizeof(glm::vec3),
+			stagingVertices.size() * sizeof(glm::vec3), stagingVertices.data());
+		glBindBuffer(GL_ARRAY_BUFFER, VBO2);
+		glBufferSubData(GL_ARRAY_BUFFER, uploadedUnits * normalsPerUnit() * sizeof(glm::vec3),
+			stagingNormals.size() * sizeof(glm::vec3), stagingNormals.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		uploadedUnits += count;
+		drawCount = static_cast<unsigned int>(uploadedUnits * verticesPerUnit());
+		budgetBytes -= std::min(budgetBytes, count * bytesPerUnit);
+
+		// Release the staging memory once everything is on the GPU.
+		if (uploadedUnits == units) {
+			std::vector<glm::vec3>().swap(stagingVertices);
+			std::vector<glm::vec3>().swap(stagingNormals);
+		}
+	}
 
-			transVecs.push_back(dataGLM[i]);
-			transVecs.push_back(dataGLM[i+1]);
-			transVecs.push_back(dataGLM[i+2]);
+	updateChunks();
+	loadIndices(budgetBytes);
+}
 
-			transVecs.push_back(dataGLM[i+1]);
-			transVecs.push_back(dataGLM[i+3]);
-			transVecs.push_back(dataGLM[i+2]);		
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::updateChunks() {
+	const size_t units = std::min(uploadedUnits, unitCount());
+	if (chunkUnits == 0) {
+		if (!isGrid()) { chunkUnits = CHUNK_UNITS; }
+		else if (gridColumns() > 0) {
+			const size_t columns = gridColumns(), rows = std::max<size_t>(CHUNK_UNITS / columns, 1);
+			chunkUnits = rows * columns;
+			chunkCells = rows * (columns - 1);
+		}
+		else { return; }
 	}
+	if (units <= chunkedUnits) { return; }
+
+	const size_t first = chunkedUnits / chunkUnits, count = (units + chunkUnits - 1) / chunkUnits;
+	chunkBounds.resize(count);
+	parallelFor(first, count, 1, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k) {
+			const size_t unitBegin = k * chunkUnits, unitEnd = std::min(unitBegin + chunkUnits, units);
+			if (!isGrid()) {
+				// Unit u is the quad of points u to u + 3.
+				const size_t last = std::min(unitEnd + 3, pointCount());
+				PointStatistics bounds = computeStatistics(points() + unitBegin, last - unitBegin);
+				chunkBounds.set(k, bounds.min(), bounds.max());
+				continue;
+			}
 
-	// Calculate normals.
-	for (int i = 0; i < transVecs.size(); i += 3) {
-		glm::vec3 normal =
-			glm::normalize(
-				glm::cross(
-					glm::vec3(transVecs[i + 1]) - glm::vec3(transVecs[i]),
-					glm::vec3(transVecs[i + 2]) - glm::vec3(transVecs[i])
-				)
-			);
-		normals.push_back(normal);
-	}
+			// Grid vertices are (row, column, depth). Include the row below, which the chunk's triangles reach.
+			const size_t columns = gridColumns();
+			const size_t rowBegin = unitBegin / columns, rowEnd = std::min((unitEnd + columns - 1) / columns + 1, gridRows());
+			ColumnStatistics depth;
+			for (size_t i = rowBegin; i < rowEnd; ++i) {
+				const float* row = datatype == DATA_TYPE::CV ? dataCV.ptr<float>(static_cast<int>(i)) : dataSTL[i].data();
+				depth.merge(computeColumnStatistics(row, columns));
+			}
+			chunkBounds.set(k, glm::vec3(static_cast<float>(rowBegin), 0.0f, depth.min),
+				glm::vec3(static_cast<float>(rowEnd - 1), static_cast<float>(columns - 1), depth.max));
+		}
+	});
+	chunkedUnits = units;
+}
 
-	unsigned int VAO_, VBO_, VBO2_, drawCount_;
-	VAO_ = VBO_ = VBO2_ = drawCount_ = 0;
+bool PointcloudVisualizer::PointcloudVisualizer::CloudMesh::needsUpload(const Frustum& frustum) {
+	// Uploaded meshes are culled by draw() alone. Bounds cover all of the data once every unit was chunked, and
+	// data that is not host resident was fully uploaded and chunked before it was released.
+	if (isUploaded() || chunkBounds.size() == 0) { return true; }
+	if (hostResident && chunkedUnits < unitCount()) { return true; }
+
+	const size_t chunks = chunkBounds.size();
+	chunkVisible.resize(chunks);
+	frustum.cull(chunkBounds, 0, chunks, chunkVisible.data());
+	visibleChunks = 0;
+	return std::any_of(chunkVisible.begin(), chunkVisible.end(), [](unsigned char chunk) { return chunk != 0; });
+}
 
-	// Load into VAO
-	glBindVertexArray(VAO_);
-	glGenVertexArrays(1, &VAO_);
-	glBindVertexArray(VAO_);
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::draw(const Frustum& frustum) {
+	const size_t elements = EBO ? indexCount : drawCount;
+	visibleChunks = 0;
+	if (!VAO || elements == 0 || chunkBounds.size() == 0) { return; }
+
+	// Merge runs of visible chunks into one range each; the chunks cover everything uploaded.
+	const size_t chunks = chunkBounds.size();
+	const size_t perChunk = EBO ? chunkCells * INDICES_PER_CELL : chunkUnits * verticesPerUnit();
+	chunkVisible.resize(chunks);
+	frustum.cull(chunkBounds, 0, chunks, chunkVisible.data());
+	drawFirsts.clear();
+	drawCounts.clear();
+	for (size_t k = 0; k < chunks; ++k) {
+		const size_t begin = k * perChunk, end = std::min(begin + perChunk, elements);
+		if (begin >= end) { break; }
+		if (!chunkVisible[k]) { continue; }
+		++visibleChunks;
+		if (!drawCounts.empty() && static_cast<size_t>(drawFirsts.back()) + drawCounts.back() == begin) {
+			drawCounts.back() += static_cast<GLsizei>(end - begin);
+		}
+		else {
+			drawFirsts.push_back(static_cast<GLint>(begin));
+			drawCounts.push_back(static_cast<GLsizei>(end - begin));
+		}
+	}
+	if (drawCounts.empty()) { return; }
 
-	// aPos
-	glGenBuffers(1, &VBO_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-	glBufferData(GL_ARRAY_BUFFER, transVecs.size() * sizeof(glm::vec3), &transVecs[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glEnableVertexAttribArray(0);
+	glBindVertexArray(VAO);
+	if (EBO) {
+		drawOffsets.resize(drawFirsts.size());
+		for (size_t i = 0; i < drawFirsts.size(); ++i) {
+			drawOffsets[i] = reinterpret_cast<const void*>(drawFirsts[i] * sizeof(unsigned int));
+		}
+		glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()));
+	}
+	else {
+		glMultiDrawArrays(GL_POINTS, drawFirsts.data(), drawCounts.data(), static_cast<GLsizei>(drawCounts.size()));
+	}
+}
 
-	// aNormal
-	glGenBuffers(1, &VBO2_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO2_);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glEnableVertexAttribArray(1);
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadIndices(size_t& budgetBytes) {
+	// Connect the cells whose four corners are all uploaded.
+	if (!triangles || !isGrid() || budgetBytes == 0) { return; }
+	const size_t rows = gridRows(), columns = gridColumns();
 
-	VAO = VAO_;
-	VBO = VBO_;
-	drawCount = transVecs.size();
+	// Changed data of another shape needs new indices.
+	if (EBO && (rows != indexedRows || columns != indexedColumns)) {
+		glDeleteBuffers(1, &EBO);
+		EBO = indexCount = 0;
+		indexedCells = 0;
+	}
 
-	transVecs.clear();
-	normals.clear();
+	const size_t completeRows = columns > 1 ? uploadedUnits / columns : 0;
+	const size_t cells = completeRows > 1 ? (completeRows - 1) * (columns - 1) : 0;
+	if (cells <= indexedCells) { return; }
+
+	glBindVertexArray(VAO);
+	if (!EBO) {
+		glGenBuffers(1, &EBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (rows - 1) * (columns - 1) * INDICES_PER_CELL * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+		indexedRows = rows;
+		indexedColumns = columns;
+	}
 
+	const size_t bytesPerCell = INDICES_PER_CELL * sizeof(unsigned int);
+	const size_t count = std::min(cells - indexedCells, std::max<size_t>(budgetBytes / bytesPerCell, 1));
+	buildIndices(indexedCells, indexedCells + count);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexedCells * bytesPerCell, stagingIndices.size() * sizeof(unsigned int), stagingIndices.data());
 	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	indexedCells += count;
+	indexCount = static_cast<unsigned int>(indexedCells * INDICES_PER_CELL);
+	budgetBytes -= std::min(budgetBytes, count * bytesPerCell);
+
+	if (indexedCells == (rows - 1) * (columns - 1)) {
+		std::vector<unsigned int>().swap(stagingIndices);
+	}
 }
 
-void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadVAO_STL() 
-{
-	// Check if this pointcloud mesh has been loaded, and if so return.
-	if (dataSTL.size() == 0 || VAO || VBO || VBO2) 
-		return;
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadStreaming(size_t& budgetBytes) {
+	const size_t units = unitCount();
+	if (!streamDirty && units == uploadedUnits) { return; }
+	streamDirty = false;
 
-	std::vector<glm::vec3> transVecs;
-	std::vector<glm::vec3> normals;
+	updateStatistics();
+	uploadedUnits = capacityUnits = units;
+	drawCount = static_cast<unsigned int>(units * verticesPerUnit());
+	if (units == 0) { return; }
 
-	x_min = y_min = z_min = 99999999;
-	x_max = y_max = z_max = -99999999;
+	// The ring replaces the static buffers of a mesh that was uploaded before streaming was turned on.
+	if (VBO) { glDeleteBuffers(1, &VBO); }
+	if (VBO2) { glDeleteBuffers(1, &VBO2); }
+	VBO = VBO2 = 0;
 
-	// Save all point coordinates on the GPU.
-	for (int i = 0; i < dataSTL.size() - 1; ++i) {
-		for (int j = 0; j < dataSTL[0].size() - 1; ++j) {
+	// Each segment holds all vertices followed by all normals. Leave room for the cloud to grow a little.
+	const size_t vertexBytes = units * verticesPerUnit() * sizeof(glm::vec3);
+	const size_t bytes = vertexBytes + units * normalsPerUnit() * sizeof(glm::vec3);
+	if (bytes > stream.segmentBytes() && !stream.allocate(bytes + bytes / 2)) {
+		drawCount = 0;
+		return;
+	}
 
-			if (j < x_min) { x_min = j; }
-			if (j > x_max) { x_max = j; }
-			if (i < y_min) { y_min = i; }
-			if (i > y_max) { y_max = i; }
+	char* segment = static_cast<char*>(stream.beginWrite());
+	glm::vec3* vertices = reinterpret_cast<glm::vec3*>(segment);
+	glm::vec3* normals = reinterpret_cast<glm::vec3*>(segment + vertexBytes);
+	switch (datatype) {
+	case DATA_TYPE::CV:
+		buildMesh(GridSource<CvAccess>(CvAccess(dataCV)), 0, units, vertices, normals);
+		break;
+	case DATA_TYPE::STL:
+		buildMesh(GridSource<RowMajorAccess>(RowMajorAccess(dataSTL)), 0, units, vertices, normals);
+		break;
+	case DATA_TYPE::GLM:
+		buildMesh(PointListSource(points(), pointCount()), 0, units, vertices, normals);
+		break;
+	}
+	const size_t offset = stream.endWrite(bytes);
 
-			float d1 = dataSTL[i][j];
-			float d2 = dataSTL[i][j + 1];
-			float d3 = dataSTL[i + 1][j];
-			float d4 = dataSTL[i + 1][j + 1];
-			std::vector<float> vec{ d1, d2, d3, d4 };
-			float dmin = *std::min_element(vec.begin(), vec.end());
-			float dmax = *std::max_element(vec.begin(), vec.end());
+	// Attribute 0 is aPos, attribute 1 is aNormal, both read from the segment just written.
+	if (!VAO) { glGenVertexArrays(1, &VAO); }
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)offset);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)(offset + vertexBytes));
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-			if (dmin < z_min) { z_min = dmin; }
-			if (dmax > z_max) { z_max = dmax; }
+	budgetBytes -= std::min(budgetBytes, bytes);
+}
 
-			transVecs.push_back(glm::vec3(i, j, d1));
-			transVecs.push_back(glm::vec3(i, j + 1, d2));
-			transVecs.push_back(glm::vec3(i + 1, j, d3));
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::dataChanged() {
+	discardSpill();
+	hostResident = true;
+	pointStatistics = PointStatistics();
+	statisticsPoints = 0;
+	chunkBounds = BoxList();
+	chunkUnits = chunkCells = chunkedUnits = 0;
+	kdTree.clear();
+	kdTreeCurrent = false;
+	streamDirty = true;
+	if (!streaming) { uploadedUnits = 0; }
+}
 
-			transVecs.push_back(glm::vec3(i, j + 1, d2));
-			transVecs.push_back(glm::vec3(i + 1, j + 1, d4));
-			transVecs.push_back(glm::vec3(i + 1, j, d3));
-		}
-	}
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::dataAppended() {
+	kdTree.clear();
+	kdTreeCurrent = false;
+}
 
-	// Calculate normals.
-	for (int i = 0; i < transVecs.size(); i += 3) {
-		glm::vec3 normal =
-			glm::normalize(
-				glm::cross(
-					glm::vec3(transVecs[i + 1]) - glm::vec3(transVecs[i]),
-					glm::vec3(transVecs[i + 2]) - glm::vec3(transVecs[i])
-				)
-			);
-		normals.push_back(normal);
-	}
+const PointcloudVisualizer::KdTree& PointcloudVisualizer::PointcloudVisualizer::CloudMesh::spatialIndex() {
+	if (!kdTreeCurrent && hostResident) { kdTreeCurrent = kdTree.build(points(), pointCount()); }
+	return kdTree;
+}
 
-	unsigned int VAO_, VBO_, VBO2_, drawCount_;
-	VAO_ = VBO_ = VBO2_ = drawCount_ = 0;
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::finishFrame() {
+	if (streaming) { stream.fence(); }
+}
 
-	// Load into VAO
-	glBindVertexArray(VAO_);
-	glGenVertexArrays(1, &VAO_);
-	glBindVertexArray(VAO_);
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::clear(){
+	if (VAO) { glDeleteVertexArrays(1, &VAO); }
+	if (VBO) { glDeleteBuffers(1, &VBO); }
+	if (VBO2) { glDeleteBuffers(1, &VBO2); }
+	if (EBO) { glDeleteBuffers(1, &EBO); }
+	stream.release();
+	VAO = VBO = VBO2 = EBO = drawCount = indexCount = 0;
+	uploadedUnits = capacityUnits = indexedCells = 0;
+	streamDirty = true;
+}
 
-	// aPos
-	glGenBuffers(1, &VBO_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-	glBufferData(GL_ARRAY_BUFFER, transVecs.size() * sizeof(glm::vec3), &transVecs[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glEnableVertexAttribArray(0);
+size_t PointcloudVisualizer::PointcloudVisualizer::CloudMesh::hostBytes() const {
+	if (!hostResident) { return 0; }
+	switch (datatype) {
+	case DATA_TYPE::CV:
+		// A Mat header over external memory (see addData(const float*, ...)) has no allocation of its own.
+		return dataCV.u == nullptr ? 0 : dataCV.total() * dataCV.elemSize();
+	case DATA_TYPE::STL: {
+		size_t bytes = 0;
+		for (const std::vector<float>& row : dataSTL) { bytes += row.size() * sizeof(float); }
+		return bytes;
+	}
+	default:
+		// Memory viewed without an owner is the caller's, not ours.
+		return externalPoints && !externalOwner ? 0 : pointCount() * sizeof(glm::vec3);
+	}
+}
 
-	// aNormal
-	glGenBuffers(1, &VBO2_);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO2_);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glEnableVertexAttribArray(1);
+size_t PointcloudVisualizer::PointcloudVisualizer::CloudMesh::gpuBytes() const {
+	size_t bytes = stream.buffer() ? stream.segmentBytes() * StreamingBuffer::SEGMENTS
+		: capacityUnits * (verticesPerUnit() + normalsPerUnit()) * sizeof(glm::vec3);
+	if (EBO) { bytes += (indexedRows - 1) * (indexedColumns - 1) * INDICES_PER_CELL * sizeof(unsigned int); }
+	return bytes;
+}
 
-	VAO = VAO_;
-	VBO = VBO_;
-	drawCount = transVecs.size();
+bool PointcloudVisualizer::PointcloudVisualizer::CloudMesh::isUploaded() const {
+	if (!hostResident) { return uploadedUnits > 0; }
+	const size_t units = unitCount();
+	if (units == 0 || uploadedUnits < units) { return false; }
+	if (!triangles || !isGrid() || gridRows() < 2 || gridColumns() < 2) { return true; }
+	return indexedCells == (gridRows() - 1) * (gridColumns() - 1);
+}
 
-	transVecs.clear();
-	normals.clear();
+bool PointcloudVisualizer::PointcloudVisualizer::CloudMesh::releaseHostData(bool spill) {
+	if (!hostResident || !isUploaded()) { return false; }
+
+	// A spill file from an earlier release is still valid, since the data has not changed since.
+	if (spill && spillPath.empty()) {
+		std::error_code error;
+		std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+		std::string path = (directory / ("pointcloudvisualizer-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+			+ "-" + std::to_string(spillFiles++) + ".spill")).string();
+
+		SpillHeader header = {};
+		std::memcpy(header.magic, SPILL_MAGIC, sizeof(header.magic));
+		header.datatype = static_cast<uint32_t>(datatype);
+		header.rows = datatype == DATA_TYPE::GLM ? pointCount() : gridRows();
+		header.columns = datatype == DATA_TYPE::GLM ? 3 : gridColumns();
+
+		std::ofstream out(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		const std::streamsize rowBytes = static_cast<std::streamsize>(header.columns * sizeof(float));
+		if (datatype == DATA_TYPE::GLM) {
+			out.write(reinterpret_cast<const char*>(points()), rowBytes * header.rows);
+		}
+		else {
+			for (size_t r = 0; r < header.rows; ++r) {
+				const float* row = datatype == DATA_TYPE::CV ? dataCV.ptr<float>(static_cast<int>(r)) : dataSTL[r].data();
+				out.write(reinterpret_cast<const char*>(row), rowBytes);
+			}
+		}
+		out.close();
+		if (!out) {
+			std::cerr << "ERROR! Could not spill cloud data to " << path << ", keeping it in memory." << std::endl;
+			std::remove(path.c_str());
+			return false;
+		}
+		spillPath = path;
+	}
 
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	dataCV.release();
+	std::vector<std::vector<float>>().swap(dataSTL);
+	std::vector<glm::vec3>().swap(dataGLM);
+	externalPoints = nullptr;
+	externalCount = 0;
+	externalOwner.reset();
+	kdTree.clear();
+	kdTreeCurrent = false;
+	hostResident = false;
+	return true;
 }
 
-void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::loadVAO() {
+bool PointcloudVisualizer::PointcloudVisualizer::CloudMesh::restoreHostData() {
+	if (hostResident) { return true; }
+	if (spillPath.empty()) { return false; }
+
+	SpillHeader header = {};
+	std::ifstream in(spillPath, std::ios::binary | std::ios::in);
+	in.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!in || std::memcmp(header.magic, SPILL_MAGIC, sizeof(header.magic)) != 0 || header.datatype != static_cast<uint32_t>(datatype)) {
+		std::cerr << "ERROR! Could not read spilled cloud data from " << spillPath << std::endl;
+		return false;
+	}
+
+	const std::streamsize rowBytes = static_cast<std::streamsize>(header.columns * sizeof(float));
 	switch (datatype) {
 	case DATA_TYPE::CV:
-		loadVAO_CV();
+		dataCV.create(static_cast<int>(header.rows), static_cast<int>(header.columns), CV_32F);
+		for (int r = 0; r < dataCV.rows; ++r) { in.read(reinterpret_cast<char*>(dataCV.ptr<float>(r)), rowBytes); }
+		break;
 	case DATA_TYPE::STL:
-		loadVAO_STL();
+		dataSTL.assign(header.rows, std::vector<float>(header.columns));
+		for (std::vector<float>& row : dataSTL) { in.read(reinterpret_cast<char*>(row.data()), rowBytes); }
+		break;
 	case DATA_TYPE::GLM:
-		loadVAO_GLM();
+		dataGLM.resize(header.rows);
+		in.read(reinterpret_cast<char*>(dataGLM.data()), rowBytes * header.rows);
+		break;
 	}
+	if (!in) {
+		std::cerr << "ERROR! Spilled cloud data in " << spillPath << " is truncated." << std::endl;
+		dataCV.release();
+		std::vector<std::vector<float>>().swap(dataSTL);
+		std::vector<glm::vec3>().swap(dataGLM);
+		return false;
+	}
+
+	hostResident = true;
+	return true;
 }
 
-void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::clear(){
-	if (VAO) { glDeleteVertexArrays(1, &VAO); }
-	if (VBO) { glDeleteBuffers(1, &VBO); }
-	if (VBO2) { glDeleteBuffers(1, &VBO2); }
+PointcloudVisualizer::PointcloudVisualizer::CloudMesh::CloudMesh(CloudMesh&& other) noexcept {
+	moveFrom(other);
+}
+
+PointcloudVisualizer::PointcloudVisualizer::CloudMesh& PointcloudVisualizer::PointcloudVisualizer::CloudMesh::operator=(CloudMesh&& other) noexcept {
+	if (this != &other) {
+		clear();
+		discardSpill();
+		moveFrom(other);
+	}
+	return *this;
+}
+
+PointcloudVisualizer::PointcloudVisualizer::CloudMesh::~CloudMesh() {
+	clear();
+	discardSpill();
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::moveFrom(CloudMesh& other) {
+	datatype = other.datatype;
+	dataCV = std::move(other.dataCV);
+	dataSTL = std::move(other.dataSTL);
+	dataGLM = std::move(other.dataGLM);
+	externalPoints = other.externalPoints;
+	externalCount = other.externalCount;
+	externalOwner = std::move(other.externalOwner);
+
+	VAO = other.VAO;
+	VBO = other.VBO;
+	VBO2 = other.VBO2;
+	EBO = other.EBO;
+	drawCount = other.drawCount;
+	indexCount = other.indexCount;
+	position = other.position;
+	scale = other.scale;
+	rotation = other.rotation;
+	cloud_color = other.cloud_color;
+	triangles = other.triangles;
+	streaming = other.streaming;
+	residency = other.residency;
+	visible = other.visible;
+	lastDrawnFrame = other.lastDrawnFrame;
+
+	pointStatistics = other.pointStatistics;
+	statisticsPoints = other.statisticsPoints;
+	uploadedUnits = other.uploadedUnits;
+	capacityUnits = other.capacityUnits;
+	indexedCells = other.indexedCells;
+	stagingVertices = std::move(other.stagingVertices);
+	stagingNormals = std::move(other.stagingNormals);
+	stagingIndices = std::move(other.stagingIndices);
+	indexedRows = other.indexedRows;
+	indexedColumns = other.indexedColumns;
+	stream = std::move(other.stream);
+	streamDirty = other.streamDirty;
+	hostResident = other.hostResident;
+	spillPath = std::move(other.spillPath);
+	chunkBounds = std::move(other.chunkBounds);
+	chunkUnits = other.chunkUnits;
+	chunkCells = other.chunkCells;
+	chunkedUnits = other.chunkedUnits;
+	visibleChunks = other.visibleChunks;
+	chunkVisible = std::move(other.chunkVisible);
+	drawFirsts = std::move(other.drawFirsts);
+	drawCounts = std::move(other.drawCounts);
+	drawOffsets = std::move(other.drawOffsets);
+	kdTree = std::move(other.kdTree);
+	kdTreeCurrent = other.kdTreeCurrent;
+	other.kdTreeCurrent = false;
+
+	// The handles now belong to this mesh; clear() on the other one only resets its counters.
+	other.VAO = other.VBO = other.VBO2 = other.EBO = 0;
+	other.externalPoints = nullptr;
+	other.externalCount = 0;
+	other.spillPath.clear();
+	other.clear();
+}
+
+void PointcloudVisualizer::PointcloudVisualizer::CloudMesh::discardSpill() {
+	if (spillPath.empty()) { return; }
+	std::remove(spillPath.c_str());
+	spillPath.clear();
 }
 
 glm::mat4 PointcloudVisualizer::rotateMatrix(glm::vec3 front,glm::mat4 mat) {
@@ -819,6 +1365,7 @@ void PointcloudVisualizer::PointcloudVisualizer::RenderLoop() {
 		lastFrame = currentFrame;
 
 		processInput(window);
+		PollLoader();
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -827,7 +1374,15 @@ void PointcloudVisualizer::PointcloudVisualizer::RenderLoop() {
 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		if (firstPixelPending && meshes.size() > 0 && meshes[0].drawCount > 0)
+		{
+			std::cout << "First points on screen " << (glfwGetTime() - loadStartTime) * 1000.0 << " ms after the load started." << std::endl;
+			firstPixelPending = false;
+		}
 	}
-	glfwTerminate();
+	// Delete the GL objects while the context still exists.
+	loader.cancel();
 	clear();
+	glfwTerminate();
 }
\ No newline at end of file
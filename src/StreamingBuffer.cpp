@@ -0,0 +1,163 @@
+#include "StreamingBuffer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace PointcloudVisualizer
+{
+	namespace
+	{
+		// Segment offsets stay aligned for any vertex attribute.
+		const size_t SEGMENT_ALIGNMENT = 256;
+
+		void WaitFence(GLsync& fence)
+		{
+			if (!fence)
+				return;
+
+			// The segment was fenced two frames ago, so this normally returns at once.
+			GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+			while (true)
+			{
+				GLenum result = glClientWaitSync(fence, flags, 1000000);
+				if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+					break;
+				flags = 0;
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	StreamingBuffer::~StreamingBuffer()
+	{
+		release();
+	}
+
+	StreamingBuffer::StreamingBuffer(StreamingBuffer&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	StreamingBuffer& StreamingBuffer::operator=(StreamingBuffer&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+		id = other.id;
+		segmentSize = other.segmentSize;
+		current = other.current;
+		written = other.written;
+		mapped = other.mapped;
+		fences = std::move(other.fences);
+		staging = std::move(other.staging);
+
+		other.id = 0;
+		other.segmentSize = 0;
+		other.mapped = nullptr;
+		other.fences.clear();
+		return *this;
+	}
+
+	bool StreamingBuffer::allocate(size_t segmentBytes)
+	{
+		release();
+
+		segmentSize = (segmentBytes + SEGMENT_ALIGNMENT - 1) / SEGMENT_ALIGNMENT * SEGMENT_ALIGNMENT;
+		const size_t totalBytes = segmentSize * SEGMENTS;
+		fences.assign(SEGMENTS, nullptr);
+		current = 0;
+		written = false;
+
+		glGenBuffers(1, &id);
+		glBindBuffer(GL_ARRAY_BUFFER, id);
+		if (GLAD_GL_VERSION_4_4)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, totalBytes, NULL, flags);
+			mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalBytes, flags));
+			if (!mapped)
+				std::cerr << "WARNING: Could not map the streaming vertex buffer, falling back to glBufferSubData." << std::endl;
+		}
+		if (!mapped)
+		{
+			// Immutable storage cannot be respecified, so the fallback needs a buffer of its own.
+			if (GLAD_GL_VERSION_4_4)
+			{
+				glDeleteBuffers(1, &id);
+				glGenBuffers(1, &id);
+				glBindBuffer(GL_ARRAY_BUFFER, id);
+			}
+			glBufferData(GL_ARRAY_BUFFER, totalBytes, NULL, GL_STREAM_DRAW);
+			staging.resize(segmentSize);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (!id)
+		{
+			std::cerr << "ERROR! Could not create a streaming vertex buffer." << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void StreamingBuffer::release()
+	{
+		for (GLsync& fence : fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+		fences.clear();
+
+		if (id)
+		{
+			if (mapped)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, id);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &id);
+		}
+		id = 0;
+		mapped = nullptr;
+		segmentSize = 0;
+		std::vector<char>().swap(staging);
+	}
+
+	void* StreamingBuffer::beginWrite()
+	{
+		if (!id)
+			return nullptr;
+
+		current = (current + 1) % SEGMENTS;
+		WaitFence(fences[current]);
+		written = false;
+		return mapped ? mapped + current * segmentSize : staging.data();
+	}
+
+	size_t StreamingBuffer::endWrite(size_t bytes)
+	{
+		const size_t offset = current * segmentSize;
+		if (!mapped && bytes > 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, id);
+			glBufferSubData(GL_ARRAY_BUFFER, offset, std::min(bytes, segmentSize), staging.data());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		written = true;
+		return offset;
+	}
+
+	void StreamingBuffer::fence()
+	{
+		if (!id || !written)
+			return;
+
+		// A segment drawn again in a later frame is fenced again, so the wait covers its last use.
+		if (fences[current])
+			glDeleteSync(fences[current]);
+		fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
@@ -1,19 +1,217 @@
 #include "StringUtils.h"
+#include <cstdint>
+#include "CpuFeatures.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace PointcloudVisualizer
 {
+	namespace
+	{
+		// Delimiter sets up to this size are matched with one vector compare per character.
+		const size_t MAX_SIMD_DELIMITERS = 8;
+
+		inline unsigned int CountTrailingZeros(uint32_t mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return index;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+
+		// Turns a block's delimiter mask into token boundaries. A token starts at a non-delimiter whose
+		// predecessor is a delimiter and ends at a delimiter whose predecessor is not; 'previous' carries
+		// the delimiter state of the last byte of the previous block.
+		inline void EmitTokens(const char* block, uint32_t delimiterMask, unsigned int width, bool& previous,
+			const char*& tokenBegin, std::vector<std::string_view>& tokens)
+		{
+			uint32_t shifted = (delimiterMask << 1) | (previous ? 1u : 0u);
+			uint32_t boundaries = (~delimiterMask & shifted) | (delimiterMask & ~shifted);
+			if (width < 32)
+				boundaries &= (1u << width) - 1;
+
+			while (boundaries)
+			{
+				unsigned int i = CountTrailingZeros(boundaries);
+				boundaries &= boundaries - 1;
+				if (delimiterMask & (1u << i))
+					tokens.emplace_back(tokenBegin, block + i - tokenBegin);
+				else
+					tokenBegin = block + i;
+			}
+
+			previous = (delimiterMask >> (width - 1)) & 1u;
+		}
+
+		uint32_t ScalarMask(const char* block, unsigned int width, const bool* table)
+		{
+			uint32_t mask = 0;
+			for (unsigned int i = 0; i < width; ++i)
+				mask |= static_cast<uint32_t>(table[static_cast<unsigned char>(block[i])]) << i;
+			return mask;
+		}
+
+#ifdef CPUFEATURES_X86
+		inline uint32_t Sse2Mask(const char* block, const __m128i* needles, size_t count)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+			__m128i hits = _mm_cmpeq_epi8(bytes, needles[0]);
+			for (size_t k = 1; k < count; ++k)
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, needles[k]));
+			return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+		}
+
+		CPUFEATURES_TARGET_AVX2 inline uint32_t Avx2Mask(const char* block, const __m256i* needles, size_t count)
+		{
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+			__m256i hits = _mm256_cmpeq_epi8(bytes, needles[0]);
+			for (size_t k = 1; k < count; ++k)
+				hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, needles[k]));
+			return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+		}
+
+		CPUFEATURES_TARGET_AVX2 const char* TokenizeAvx2(const char* p, const char* end, std::string_view delimiters,
+			bool& previous, const char*& tokenBegin, std::vector<std::string_view>& tokens)
+		{
+			__m256i needles[MAX_SIMD_DELIMITERS];
+			for (size_t k = 0; k < delimiters.size(); ++k)
+				needles[k] = _mm256_set1_epi8(delimiters[k]);
+
+			for (; end - p >= 32; p += 32)
+				EmitTokens(p, Avx2Mask(p, needles, delimiters.size()), 32, previous, tokenBegin, tokens);
+			return p;
+		}
+
+		const char* TokenizeSse2(const char* p, const char* end, std::string_view delimiters,
+			bool& previous, const char*& tokenBegin, std::vector<std::string_view>& tokens)
+		{
+			__m128i needles[MAX_SIMD_DELIMITERS];
+			for (size_t k = 0; k < delimiters.size(); ++k)
+				needles[k] = _mm_set1_epi8(delimiters[k]);
+
+			for (; end - p >= 16; p += 16)
+				EmitTokens(p, Sse2Mask(p, needles, delimiters.size()), 16, previous, tokenBegin, tokens);
+			return p;
+		}
+
+		typedef const char* (*TokenizeBlocks)(const char* p, const char* end, std::string_view delimiters,
+			bool& previous, const char*& tokenBegin, std::vector<std::string_view>& tokens);
+
+		// Both advance p over whole blocks and return true with p on the match if one is found.
+		CPUFEATURES_TARGET_AVX2 bool FindAvx2(const char*& p, const char* end, std::string_view characters)
+		{
+			__m256i needles[MAX_SIMD_DELIMITERS];
+			for (size_t k = 0; k < characters.size(); ++k)
+				needles[k] = _mm256_set1_epi8(characters[k]);
+
+			for (; end - p >= 32; p += 32)
+			{
+				uint32_t mask = Avx2Mask(p, needles, characters.size());
+				if (mask)
+				{
+					p += CountTrailingZeros(mask);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool FindSse2(const char*& p, const char* end, std::string_view characters)
+		{
+			__m128i needles[MAX_SIMD_DELIMITERS];
+			for (size_t k = 0; k < characters.size(); ++k)
+				needles[k] = _mm_set1_epi8(characters[k]);
+
+			for (; end - p >= 16; p += 16)
+			{
+				uint32_t mask = Sse2Mask(p, needles, characters.size());
+				if (mask)
+				{
+					p += CountTrailingZeros(mask);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		typedef bool (*FindBlocks)(const char*& p, const char* end, std::string_view characters);
+#endif
+	}
+
 	std::vector<std::string> tokenize(std::string toTokenize, std::string token) 
 	{
+		std::vector<std::string_view> views;
+		tokenizeView(toTokenize, token, views);
+
 		std::vector<std::string> result;
-		char* tk = strtok((char*)toTokenize.c_str(), token.c_str());
+		result.reserve(views.size());
+		for (const std::string_view& view : views)
+			result.emplace_back(view);
+
+		return result;
+	}
 
-		// Keep printing tokens while one of delimiters are present. 
-		while (tk != NULL)
+	size_t tokenizeView(std::string_view text, std::string_view delimiters, std::vector<std::string_view>& tokens)
+	{
+		tokens.clear();
+		if (text.empty())
+			return 0;
+
+		const char* p = text.data();
+		const char* end = p + text.size();
+		const char* tokenBegin = p;
+		bool previous = true; // The start of the text behaves like a preceding delimiter.
+
+#ifdef CPUFEATURES_X86
+		if (delimiters.size() > 0 && delimiters.size() <= MAX_SIMD_DELIMITERS)
 		{
-			result.push_back(tk);
-			tk = strtok(NULL, token.c_str());
+			TokenizeBlocks tokenizeBlocks = selectKernel<TokenizeBlocks>(nullptr, TokenizeSse2, TokenizeAvx2, nullptr);
+			if (tokenizeBlocks)
+				p = tokenizeBlocks(p, end, delimiters, previous, tokenBegin, tokens);
 		}
+#endif
 
-		return result;
+		bool table[256] = {};
+		for (char c : delimiters)
+			table[static_cast<unsigned char>(c)] = true;
+
+		for (; p < end; p += 32)
+		{
+			unsigned int width = static_cast<unsigned int>(end - p < 32 ? end - p : 32);
+			EmitTokens(p, ScalarMask(p, width, table), width, previous, tokenBegin, tokens);
+		}
+
+		// Close a token that runs to the end of the text.
+		if (!previous)
+			tokens.emplace_back(tokenBegin, end - tokenBegin);
+
+		return tokens.size();
+	}
+
+	const char* findFirstOf(const char* begin, const char* end, std::string_view characters)
+	{
+		const char* p = begin;
+
+#ifdef CPUFEATURES_X86
+		if (characters.size() > 0 && characters.size() <= MAX_SIMD_DELIMITERS)
+		{
+			FindBlocks findBlocks = selectKernel<FindBlocks>(nullptr, FindSse2, FindAvx2, nullptr);
+			if (findBlocks && findBlocks(p, end, characters))
+				return p;
+		}
+#endif
+
+		for (; p < end; ++p)
+		{
+			if (characters.find(*p) != std::string_view::npos)
+				return p;
+		}
+
+		return end;
 	}
 }
\ No newline at end of file
@@ -1,73 +1,134 @@
 #include "stdafx.h"
 #include "PointcloudVisualizer.h"
-#include "PCDparser.h"
-#include "StringUtils.h"
+#include "CpuFeatures.h"
 
 
 int main(int argc, char** argv)
 {
-	if (argc <= 1)
+	// Parse options; the first argument that is not an option is the pointcloud file.
+	std::string pointcloudFilename = "";
+	bool useCache = true;
+	size_t uploadBudgetMiB = 0;
+	unsigned int threads = 0;
+	PointcloudVisualizer::Residency residency = PointcloudVisualizer::Residency::Keep;
+	size_t hostBudgetMiB = 0, gpuBudgetMiB = 0;
+	bool lod = false;
+	size_t pointBudget = 0;
+	bool culling = true;
+	bool spatialSort = false;
+	float voxelSize = 0.0f;
+	PointcloudVisualizer::VoxelMode voxelMode = PointcloudVisualizer::VoxelMode::Centroid;
+	float outlierSigma = 0.0f;
+	unsigned int outlierNeighbours = 0;
+	for (int i = 1; i < argc; ++i)
 	{
-		std::cerr << "ERROR! Arguments must be of the format: 'PointcloudVisualizer.exe [pointcloud file name]'." << std::endl;
+		std::string argument = argv[i];
+		if (argument == "--no-cache")
+			useCache = false;
+		else if (argument.rfind("--simd=", 0) == 0)
+		{
+			PointcloudVisualizer::SimdLevel level;
+			if (!PointcloudVisualizer::parseSimdLevel(argument.substr(7), level))
+			{
+				std::cerr << "ERROR! Unknown SIMD level '" << argument.substr(7) << "', expected scalar, sse2, avx2 or avx512." << std::endl;
+				return -1;
+			}
+			PointcloudVisualizer::setSimdLevel(level);
+		}
+		else if (argument.rfind("--upload-budget=", 0) == 0)
+			uploadBudgetMiB = std::strtoul(argument.c_str() + 16, nullptr, 10);
+		else if (argument.rfind("--threads=", 0) == 0)
+			threads = static_cast<unsigned int>(std::strtoul(argument.c_str() + 10, nullptr, 10));
+		else if (argument.rfind("--residency=", 0) == 0)
+		{
+			if (!PointcloudVisualizer::parseResidency(argument.substr(12), residency))
+			{
+				std::cerr << "ERROR! Unknown residency '" << argument.substr(12) << "', expected keep, release or spill." << std::endl;
+				return -1;
+			}
+		}
+		else if (argument.rfind("--host-budget=", 0) == 0)
+			hostBudgetMiB = std::strtoul(argument.c_str() + 14, nullptr, 10);
+		else if (argument.rfind("--gpu-budget=", 0) == 0)
+			gpuBudgetMiB = std::strtoul(argument.c_str() + 13, nullptr, 10);
+		else if (argument == "--no-culling")
+			culling = false;
+		else if (argument == "--spatial-sort")
+			spatialSort = true;
+		else if (argument.rfind("--voxel=", 0) == 0)
+			voxelSize = std::strtof(argument.c_str() + 8, nullptr);
+		else if (argument == "--voxel-first")
+			voxelMode = PointcloudVisualizer::VoxelMode::First;
+		else if (argument.rfind("--outliers=", 0) == 0)
+			outlierSigma = std::strtof(argument.c_str() + 11, nullptr);
+		else if (argument.rfind("--outlier-neighbours=", 0) == 0)
+			outlierNeighbours = static_cast<unsigned int>(std::strtoul(argument.c_str() + 21, nullptr, 10));
+		else if (argument == "--lod")
+			lod = true;
+		else if (argument.rfind("--point-budget=", 0) == 0)
+			pointBudget = std::strtoull(argument.c_str() + 15, nullptr, 10);
+		else if (pointcloudFilename.empty())
+			pointcloudFilename = argument;
+	}
+
+	if (pointcloudFilename.empty())
+	{
+		std::cerr << "ERROR! Arguments must be of the format: 'PointcloudVisualizer.exe [options] [pointcloud file name]'." << std::endl;
 		std::cerr << "Files may be in the following formats: pcd, csv, depth images (jpg/jpeg,png,bmp,ppm,tiff)" << std::endl;
+		std::cerr << "Options: --no-cache (neither read nor write the .pcvcache sidecar of pcd/csv files)" << std::endl;
+		std::cerr << "         --upload-budget=<MiB> (vertex data uploaded to the GPU per frame, default 32)" << std::endl;
+		std::cerr << "         --simd=scalar|sse2|avx2|avx512 (highest instruction set the kernels may use, default: detected)" << std::endl;
+		std::cerr << "         --threads=<N> (threads used for loading and mesh building, default: all hardware threads)" << std::endl;
+		std::cerr << "         --residency=keep|release|spill (what happens to the host copy of a cloud once it is on the GPU, default keep)" << std::endl;
+		std::cerr << "         --host-budget=<MiB>, --gpu-budget=<MiB> (memory limits that evict the least recently drawn clouds, default unlimited)" << std::endl;
+		std::cerr << "         --no-culling (draw every chunk of a cloud, also those outside the view)" << std::endl;
+		std::cerr << "         --spatial-sort (reorder pcd/csv points along a Morton curve before upload)" << std::endl;
+		std::cerr << "         --voxel=<size> (downsample pcd/csv files to one point per voxel of this size, the centroid of its points)" << std::endl;
+		std::cerr << "         --voxel-first (keep the first point of each voxel instead of the centroid)" << std::endl;
+		std::cerr << "         --outliers=<sigma> (drop pcd/csv points whose mean neighbour distance is more than sigma standard deviations above average)" << std::endl;
+		std::cerr << "         --outlier-neighbours=<N> (neighbours averaged over with --outliers, default 8)" << std::endl;
+		std::cerr << "         --lod (draw pcd/csv files level of detail through a .pcvoctree built on first use)" << std::endl;
+		std::cerr << "         --point-budget=<N> (points drawn per frame with --lod, default 10000000)" << std::endl;
+		return -1;
 	}
 
+	std::cout << "SIMD kernels: " << PointcloudVisualizer::simdLevelName(PointcloudVisualizer::simdLevel())
+		<< " (detected " << PointcloudVisualizer::simdLevelName(PointcloudVisualizer::detectedSimdLevel()) << ")" << std::endl;
+
 	PointcloudVisualizer::PointcloudVisualizer pcv;
+	pcv.workerThreads = threads;
+	pcv.residency = residency;
+	pcv.memoryBudget.hostLimit = hostBudgetMiB << 20;
+	pcv.memoryBudget.gpuLimit = gpuBudgetMiB << 20;
+	pcv.frustumCulling = culling;
+	pcv.spatialSort = spatialSort;
+	pcv.voxelSize = voxelSize;
+	pcv.voxelMode = voxelMode;
+	pcv.outlierSigma = outlierSigma;
+	if (outlierNeighbours > 0)
+		pcv.outlierNeighbours = outlierNeighbours;
 	pcv.initialize(1280, 720);
+	if (uploadBudgetMiB > 0)
+		pcv.uploadBudget = uploadBudgetMiB << 20;
+	if (pointBudget > 0)
+		pcv.pointBudget = pointBudget;
 
-	// Get filename, convert to lowercase, parse filetype.
-	std::string pointcloudFilename = argv[1];
+	// Get filename, convert to lowercase.
 	for (unsigned int i = 0; i < pointcloudFilename.size(); ++i)
 	{
 		pointcloudFilename[i] = std::tolower(pointcloudFilename[i]);
 	}
 
-	std::string extension = pointcloudFilename.substr(pointcloudFilename.rfind("."));
-
-
-	// Load data by format.
-	if (extension == ".pcd")
+	if (lod)
 	{
-		PCDparser::PCDparser pcdParser(pointcloudFilename);
-		pcv.addData(pcdParser.data);
+		// Build the octree once; later runs map it and stream only the nodes in view.
+		if (!PointcloudVisualizer::Octree::isCurrent(pointcloudFilename) && !PointcloudVisualizer::Octree::buildFromSource(pointcloudFilename))
+			return -1;
+		if (!pcv.addOctree(pointcloudFilename, glm::vec3(0, 0, -20)))
+			return -1;
 	}
-
-	else if (extension == ".csv") // Handle ascii CSV text data
-	{
-		std::ifstream infile(pointcloudFilename, std::ios::binary | std::ios::in);
-		std::string inputBuffer = "";
-		std::vector<std::vector<float>> data;
-
-		std::vector<float> currentPoint;
-		while (std::getline(infile, inputBuffer))
-		{
-			std::vector<std::string> parsedLine = PointcloudVisualizer::tokenize(inputBuffer, ",");
-
-			for (unsigned int i = 0; i < parsedLine.size(); ++i)
-			{
-				if (currentPoint.size() == 3)
-				{
-					data.push_back(currentPoint);
-					currentPoint.clear();
-				}
-				currentPoint.push_back(std::stof(parsedLine[i]));
-			}
-		}
-
-		infile.close();
-		pcv.addData(data);
-		data.clear();
-	}
-	else // Default behavior, handle greyscale image files (to be read using OpenCV's codecs)
-	{
-		cv::Mat data1;
-		data1 = cv::imread(pointcloudFilename, cv::IMREAD_GRAYSCALE);
-		pcv.addData(data1);
-	}
-
-	pcv.meshes[0].scale = glm::vec3(1);
-	pcv.meshes[0].rotation = glm::vec3(0);
-	pcv.meshes[0].position = glm::vec3(0,0,-20);
+	else // Load in the background; the render loop shows points as soon as the first batches arrive.
+		pcv.loadAsync(pointcloudFilename, useCache, glm::vec3(0, 0, -20));
 
 	pcv.RenderLoop();
 